@@ -0,0 +1,176 @@
+/* Builds binary command frames (FrameCodec.h) for scripts and decodes
+ * the replies. Frames go to stdout, so they can be piped to the serial
+ * port; the decoder reads the port's output and skips any text around the
+ * frames.
+ *
+ *   frame_tool [--seq N] color [!]R,1000 [Y,500 ...]
+ *   frame_tool [--seq N] alarm DELAY_MS COLOR MS [COUNT]
+ *   frame_tool [--seq N] program 'P:R2000;Y500;G2000;L5'
+ *   frame_tool [--seq N] query
+ *   frame_tool [--seq N] schedule FILE.bin
+ *   frame_tool decode < replies
+ *
+ * A schedule upload replaces the running schedule and holds at most
+ * FRAME_SCHEDULE_ENTRIES_MAX (56) entries. Larger images cannot be
+ * uploaded; link them into flash with -DALARM_SCHEDULE_BIN. */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "CommandParser.h"
+#include "FrameCodec.h"
+
+namespace {
+
+void put_le32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+/* Runs one text line through the firmware's own parser. */
+bool parse_line(const char *text, struct command *cmd)
+{
+    struct cmd_parser p;
+    cmd_parser_init(&p);
+    for (const char *s = text; *s; s++) cmd_parser_feed(&p, *s, cmd);
+    return cmd_parser_feed(&p, '\n', cmd);
+}
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--seq N] color [!]R,1000 [Y,500 ...]\n"
+            "       %s [--seq N] alarm DELAY_MS COLOR MS [COUNT]\n"
+            "       %s [--seq N] program 'P:R2000;Y500;G2000;L5'\n"
+            "       %s [--seq N] query\n"
+            "       %s [--seq N] schedule FILE.bin\n"
+            "       %s decode < replies\n"
+            "A schedule upload replaces the running one and holds at most %d entries;\n"
+            "larger images must be built into the firmware with -DALARM_SCHEDULE_BIN.\n",
+            argv0, argv0, argv0, argv0, argv0, argv0, FRAME_SCHEDULE_ENTRIES_MAX);
+}
+
+int decode(void)
+{
+    std::vector<uint8_t> buf;
+    bool in_frame = false;
+    int c;
+
+    while ((c = getchar()) != EOF) {
+        if (c != 0) {
+            if (in_frame) buf.push_back((uint8_t)c);
+            continue;
+        }
+        if (!in_frame || buf.empty()) {
+            in_frame = true;
+            buf.clear();
+            continue;
+        }
+
+        struct frame f;
+        int st = buf.size() <= FRAME_WIRE_MAX ? frame_decode(buf.data(), buf.size(), &f)
+                                              : FRAME_STATUS_BAD_FRAME;
+        if (st != FRAME_STATUS_OK) {
+            printf("bad frame (%d)\n", st);
+        } else {
+            printf("seq=%u type=0x%02x", f.seq, f.type);
+            if (f.len > 0) printf(" status=%u", f.payload[0]);
+            for (size_t i = 1; i < f.len; i++) printf(" %02x", f.payload[i]);
+            printf("\n");
+        }
+        in_frame = false;
+        buf.clear();
+    }
+    return 0;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+    unsigned long seq = 0;
+    int i = 1;
+
+    if (i + 1 < argc && strcmp(argv[i], "--seq") == 0) {
+        seq = strtoul(argv[i + 1], nullptr, 0);
+        i += 2;
+    }
+    if (i >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const char *what = argv[i++];
+    std::vector<uint8_t> payload;
+    uint8_t type;
+
+    if (strcmp(what, "decode") == 0) {
+        return decode();
+
+    } else if (strcmp(what, "color") == 0 && i < argc) {
+        type = FRAME_COLOR;
+        payload.push_back(argv[i][0] == '!' ? 0x01 : 0x00);
+        for (; i < argc; i++) {
+            struct command cmd;
+            const char *text = argv[i][0] == '!' ? argv[i] + 1 : argv[i];
+            if (!parse_line(text, &cmd) || cmd.type != CMD_WORD || cmd.word_len != 1) {
+                fprintf(stderr, "bad colour command: %s\n", argv[i]);
+                return 2;
+            }
+            payload.push_back((uint8_t)cmd.word[0]);
+            put_le32(payload, cmd.has_arg ? cmd.arg : 1000);
+        }
+
+    } else if (strcmp(what, "alarm") == 0 && (argc - i == 3 || argc - i == 4)) {
+        type = FRAME_ALARM;
+        put_le32(payload, (uint32_t)strtoul(argv[i], nullptr, 0));
+        payload.push_back((uint8_t)argv[i + 1][0]);
+        put_le32(payload, (uint32_t)strtoul(argv[i + 2], nullptr, 0));
+        put_le32(payload, argc - i == 4 ? (uint32_t)strtoul(argv[i + 3], nullptr, 0) : 0);
+
+    } else if (strcmp(what, "program") == 0 && argc - i == 1) {
+        struct command cmd;
+        if (!parse_line(argv[i], &cmd) || cmd.type != CMD_PROGRAM) {
+            fprintf(stderr, "bad program: %s\n", argv[i]);
+            return 2;
+        }
+        type = FRAME_PROGRAM;
+        put_le32(payload, cmd.program.loops);
+        for (uint8_t k = 0; k < cmd.program.count; k++) put_le32(payload, cmd.program.steps[k]);
+
+    } else if (strcmp(what, "query") == 0 && argc == i) {
+        type = FRAME_QUERY;
+
+    } else if (strcmp(what, "schedule") == 0 && argc - i == 1) {
+        FILE *in = fopen(argv[i], "rb");
+        if (in == nullptr) {
+            perror(argv[i]);
+            return 2;
+        }
+        int c;
+        while ((c = fgetc(in)) != EOF) payload.push_back((uint8_t)c);
+        fclose(in);
+        type = FRAME_SCHEDULE;
+
+    } else {
+        usage(argv[0]);
+        return 2;
+    }
+
+    uint8_t wire[FRAME_WIRE_MAX];
+    size_t n = frame_encode((uint8_t)seq, type, payload.data(), payload.size(), wire, sizeof(wire));
+    if (n == 0) {
+        fprintf(stderr, "payload too long (%zu > %d bytes)\n", payload.size(), FRAME_PAYLOAD_MAX);
+        if (type == FRAME_SCHEDULE) {
+            fprintf(stderr,
+                    "a schedule upload holds at most %d entries; build larger schedules into\n"
+                    "the firmware with -DALARM_SCHEDULE_BIN instead\n",
+                    FRAME_SCHEDULE_ENTRIES_MAX);
+        }
+        return 1;
+    }
+    fwrite(wire, 1, n, stdout);
+    return 0;
+}
@@ -0,0 +1,162 @@
+/* Host tests for FrameCodec: CRC-16, COBS and whole frames. Run with
+ * ctest, or directly; prints each failure and exits non-zero if any. */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "FrameCodec.h"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+std::vector<uint8_t> pattern(size_t len, int kind)
+{
+    std::vector<uint8_t> v(len);
+    for (size_t i = 0; i < len; i++) {
+        switch (kind) {
+        case 0: v[i] = (uint8_t)(i % 255 + 1); break;   /* no zeros at all */
+        case 1: v[i] = 0x00; break;
+        case 2: v[i] = 0xFF; break;
+        default: v[i] = (i / 7) % 2 ? 0x00 : 0xFF; break;  /* alternating runs */
+        }
+    }
+    return v;
+}
+
+void test_crc(void)
+{
+    /* CRC-16/CCITT-FALSE check value */
+    CHECK(frame_crc16(0xFFFF, "123456789", 9) == 0x29B1);
+    CHECK(frame_crc16(0xFFFF, "", 0) == 0xFFFF);
+
+    /* feeding in pieces gives the same result */
+    uint16_t crc = frame_crc16(0xFFFF, "1234", 4);
+    CHECK(frame_crc16(crc, "56789", 5) == 0x29B1);
+}
+
+void cobs_round_trip(size_t len, int kind)
+{
+    std::vector<uint8_t> in = pattern(len, kind);
+    std::vector<uint8_t> enc(len + len / 254 + 1);
+    size_t n = cobs_encode(in.data(), len, enc.data());
+
+    CHECK(n <= enc.size());
+    CHECK(memchr(enc.data(), 0, n) == nullptr);
+
+    /* in place, as frame_decode() does */
+    int m = cobs_decode(enc.data(), n, enc.data(), enc.size());
+    CHECK(m == (int)len);
+    if (m == (int)len) CHECK(len == 0 || memcmp(enc.data(), in.data(), len) == 0);
+}
+
+void test_cobs(void)
+{
+    static const size_t lens[] = { 0, 1, 253, 254, 255, 508, FRAME_BODY_MAX };
+    for (size_t len : lens) {
+        for (int kind = 0; kind < 4; kind++) cobs_round_trip(len, kind);
+    }
+
+    uint8_t out[8];
+    const uint8_t zero_code[] = { 0x00, 0x11 };
+    CHECK(cobs_decode(zero_code, sizeof(zero_code), out, sizeof(out)) == -1);
+    const uint8_t overrun[] = { 0x05, 0x11, 0x22 };        /* block claims 4 bytes */
+    CHECK(cobs_decode(overrun, sizeof(overrun), out, sizeof(out)) == -1);
+    const uint8_t too_big[] = { 0x04, 0x11, 0x22, 0x33 };
+    CHECK(cobs_decode(too_big, sizeof(too_big), out, 2) == -1);
+}
+
+/* Encodes a frame and decodes what lies between its delimiters. */
+int frame_round_trip(const std::vector<uint8_t> &payload, std::vector<uint8_t> &wire, struct frame *f)
+{
+    wire.assign(FRAME_WIRE_MAX, 0xAA);
+    size_t n = frame_encode(0x42, FRAME_SCHEDULE, payload.data(), payload.size(), wire.data(), wire.size());
+    CHECK(n >= 6 && n <= FRAME_WIRE_MAX);
+    if (n < 6) return -1;
+    CHECK(wire[0] == 0 && wire[n - 1] == 0);
+    CHECK(memchr(&wire[1], 0, n - 2) == nullptr);
+    wire.resize(n);
+    return frame_decode(&wire[1], n - 2, f);
+}
+
+void test_frames(void)
+{
+    static const size_t lens[] = { 0, 1, 200, FRAME_PAYLOAD_MAX - 1, FRAME_PAYLOAD_MAX };
+    for (size_t len : lens) {
+        for (int kind = 0; kind < 4; kind++) {
+            std::vector<uint8_t> payload = pattern(len, kind);
+            std::vector<uint8_t> wire;
+            struct frame f;
+
+            CHECK(frame_round_trip(payload, wire, &f) == FRAME_STATUS_OK);
+            CHECK(f.seq == 0x42 && f.type == FRAME_SCHEDULE);
+            CHECK(f.len == len);
+            CHECK(len == 0 || (f.payload && memcmp(f.payload, payload.data(), len) == 0));
+        }
+    }
+
+    /* one byte over the limit, or no room for the result */
+    std::vector<uint8_t> big(FRAME_PAYLOAD_MAX + 1, 0x11);
+    uint8_t wire[FRAME_WIRE_MAX + 8];
+    CHECK(frame_encode(1, FRAME_SCHEDULE, big.data(), big.size(), wire, sizeof(wire)) == 0);
+    CHECK(frame_encode(1, FRAME_QUERY, nullptr, 0, wire, 5) == 0);
+}
+
+void test_bad_frames(void)
+{
+    std::vector<uint8_t> payload = pattern(16, 3);
+    std::vector<uint8_t> wire;
+    struct frame f;
+    CHECK(frame_round_trip(payload, wire, &f) == FRAME_STATUS_OK);
+
+    /* a body whose CRC has one bit flipped */
+    uint8_t body[FRAME_BODY_MAX];
+    body[0] = 7;
+    body[1] = FRAME_COLOR;
+    memcpy(&body[2], payload.data(), payload.size());
+    uint16_t crc = frame_crc16(0xFFFF, body, payload.size() + 2);
+    body[payload.size() + 2] = (uint8_t)crc;
+    body[payload.size() + 3] = (uint8_t)((crc >> 8) ^ 0x01);
+    uint8_t enc[FRAME_WIRE_MAX];
+    size_t n = cobs_encode(body, payload.size() + 4, enc);
+    CHECK(frame_decode(enc, n, &f) == FRAME_STATUS_BAD_CRC);
+    CHECK(f.seq == 7 && f.type == FRAME_COLOR);   /* still known, for the reply */
+
+    /* truncated: the last COBS block runs past the end */
+    std::vector<uint8_t> cut(wire.begin() + 1, wire.end() - 1);
+    CHECK(frame_decode(cut.data(), cut.size() - 3, &f) == FRAME_STATUS_BAD_FRAME);
+
+    /* too short to hold seq, type and CRC */
+    uint8_t tiny[] = { 0x03, 0x01, 0x02 };
+    CHECK(frame_decode(tiny, sizeof(tiny), &f) == FRAME_STATUS_BAD_FRAME);
+    CHECK(f.seq == 1 && f.type == 2);
+
+    /* empty between two delimiters */
+    CHECK(frame_decode(tiny, 0, &f) == FRAME_STATUS_BAD_FRAME);
+}
+
+}  // namespace
+
+int main()
+{
+    test_crc();
+    test_cobs();
+    test_frames();
+    test_bad_frames();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("framecodec_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,225 @@
+/* Validates alarm schedule files offline, before they are uploaded.
+ *
+ * The file is memory-mapped and split into newline-aligned chunks, one
+ * per worker thread. Every line is fed through the same cmd_parser that
+ * uart_task uses, so a line passes here exactly when the board would
+ * accept it as an HHMMSS[/x] time command.
+ *
+ *   schedule_check [--threads N] [--max-lines N] FILE */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CommandParser.h"
+#include "TimeParser.h"
+
+namespace {
+
+/* Result slots: 0 = ok, 1..7 = -TIME_ERROR_*, then the non-time outcomes. */
+enum {
+    SLOT_OK = 0,
+    SLOT_NOT_TIME = 8,
+    SLOT_MALFORMED,
+    SLOT_TOO_LONG,
+    SLOT_COUNT,
+};
+
+const char *slot_name(int s)
+{
+    switch (s) {
+    case SLOT_OK:                   return "ok";
+    case -TIME_ERROR_NULL:          return "TIME_ERROR_NULL";
+    case -TIME_ERROR_LENGTH:        return "TIME_ERROR_LENGTH";
+    case -TIME_ERROR_NOT_NUMERIC:   return "TIME_ERROR_NOT_NUMERIC";
+    case -TIME_ERROR_HOUR_RANGE:    return "TIME_ERROR_HOUR_RANGE";
+    case -TIME_ERROR_MINUTE_RANGE:  return "TIME_ERROR_MINUTE_RANGE";
+    case -TIME_ERROR_SECOND_RANGE:  return "TIME_ERROR_SECOND_RANGE";
+    case -TIME_ERROR_ZERO_TIME:     return "TIME_ERROR_ZERO_TIME";
+    case SLOT_NOT_TIME:             return "not_a_time_command";
+    case SLOT_MALFORMED:            return "malformed";
+    case SLOT_TOO_LONG:             return "too_long";
+    }
+    return "?";
+}
+
+int slot_of(const struct command &c)
+{
+    switch (c.type) {
+    case CMD_TIME:     return c.time.error ? -c.time.error : SLOT_OK;
+    case CMD_TOO_LONG: return SLOT_TOO_LONG;
+    case CMD_WORD:     return SLOT_NOT_TIME;
+    default:           return SLOT_MALFORMED;
+    }
+}
+
+struct Failure {
+    uint64_t line;   /* chunk-local until merged, then 1-based */
+    int slot;
+};
+
+struct Chunk {
+    const char *begin;
+    const char *end;
+    uint64_t lines = 0;
+    uint64_t counts[SLOT_COUNT] = {};
+    std::vector<Failure> failures;
+};
+
+void check_chunk(Chunk &ch, bool last)
+{
+    struct cmd_parser p;
+    struct command cmd;
+    cmd_parser_init(&p);
+
+    for (const char *s = ch.begin; s < ch.end; s++) {
+        if (cmd_parser_feed(&p, *s, &cmd)) {
+            int slot = slot_of(cmd);
+            ch.counts[slot]++;
+            if (slot != SLOT_OK) ch.failures.push_back({ ch.lines, slot });
+        }
+        if (*s == '\n') ch.lines++;
+    }
+
+    /* a final line without a newline still counts */
+    if (last && cmd_parser_feed(&p, '\n', &cmd)) {
+        int slot = slot_of(cmd);
+        ch.counts[slot]++;
+        if (slot != SLOT_OK) ch.failures.push_back({ ch.lines, slot });
+    }
+}
+
+void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [--threads N] [--max-lines N] FILE\n"
+                    "  --max-lines N  line numbers listed per error code (default 10, 0 = all)\n",
+            argv0);
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t max_lines = 10;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = (unsigned)std::max(1L, strtol(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--max-lines") == 0 && i + 1 < argc) {
+            max_lines = strtoull(argv[++i], nullptr, 10);
+        } else if (argv[i][0] != '-' && path == nullptr) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == nullptr) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 2;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return 2;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *data = nullptr;
+    if (size > 0) {
+        void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) {
+            perror("mmap");
+            close(fd);
+            return 2;
+        }
+        madvise(m, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(m);
+    }
+    close(fd);
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    /* newline-aligned chunks */
+    std::vector<Chunk> chunks;
+    const char *end = data + size;
+    const char *pos = data;
+    for (unsigned i = 0; i < threads && pos < end; i++) {
+        const char *cut = (i + 1 == threads) ? end : data + (size / threads) * (i + 1);
+        if (cut < pos) cut = pos;
+        if (cut < end) {
+            const char *nl = static_cast<const char *>(memchr(cut, '\n', (size_t)(end - cut)));
+            cut = nl ? nl + 1 : end;
+        }
+        Chunk ch;
+        ch.begin = pos;
+        ch.end = cut;
+        chunks.push_back(std::move(ch));
+        pos = cut;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        workers.emplace_back(check_chunk, std::ref(chunks[i]), i + 1 == chunks.size());
+    }
+    for (auto &w : workers) w.join();
+
+    auto t1 = std::chrono::steady_clock::now();
+
+    /* merge, turning chunk-local line indexes into file line numbers */
+    uint64_t counts[SLOT_COUNT] = {};
+    uint64_t listed[SLOT_COUNT] = {};
+    uint64_t first_line = 1;
+    uint64_t total = 0;
+    uint64_t failed = 0;
+    std::vector<Failure> shown;
+
+    for (auto &ch : chunks) {
+        for (int s = 0; s < SLOT_COUNT; s++) {
+            counts[s] += ch.counts[s];
+            total += ch.counts[s];
+        }
+        for (auto &f : ch.failures) {
+            failed++;
+            if (max_lines == 0 || listed[f.slot] < max_lines) {
+                listed[f.slot]++;
+                shown.push_back({ first_line + f.line, f.slot });
+            }
+        }
+        first_line += ch.lines;
+    }
+
+    for (int s = 0; s < SLOT_COUNT; s++) {
+        int code = (s >= 1 && s <= 7) ? -s : 0;
+        printf("%-24s %4d %12llu\n", slot_name(s), code, (unsigned long long)counts[s]);
+    }
+    for (auto &f : shown) {
+        printf("line %llu: %s\n", (unsigned long long)f.line, slot_name(f.slot));
+    }
+
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    fprintf(stderr, "%llu commands, %llu failed, %zu bytes, %u threads, %.3f s (%.1f M lines/s)\n",
+            (unsigned long long)total, (unsigned long long)failed, size, (unsigned)chunks.size(),
+            secs, secs > 0 ? (double)total / secs / 1e6 : 0.0);
+
+    if (data) munmap(const_cast<char *>(data), size);
+    return failed ? 1 : 0;
+}
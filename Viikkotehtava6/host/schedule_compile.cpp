@@ -0,0 +1,131 @@
+/* Compiles a text alarm schedule (one HHMMSS[.mmm][/x] per line, the same
+ * syntax uart_task accepts) into the binary table described in
+ * AlarmSchedule.h. The firmware reads the result in place.
+ *
+ *   schedule_compile [--skip-invalid] IN.txt OUT.bin */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "AlarmSchedule.h"
+#include "CommandParser.h"
+
+namespace {
+
+void put_le16(std::vector<uint8_t> &out, uint16_t v)
+{
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+void put_le32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [--skip-invalid] IN.txt OUT.bin\n", argv0);
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+    bool skip_invalid = false;
+    const char *in_path = nullptr;
+    const char *out_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--skip-invalid") == 0) {
+            skip_invalid = true;
+        } else if (argv[i][0] != '-' && in_path == nullptr) {
+            in_path = argv[i];
+        } else if (argv[i][0] != '-' && out_path == nullptr) {
+            out_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (in_path == nullptr || out_path == nullptr) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(in_path, "rb");
+    if (in == nullptr) {
+        perror(in_path);
+        return 2;
+    }
+
+    std::vector<uint32_t> entries;
+    struct cmd_parser p;
+    struct command cmd;
+    unsigned long line = 1;
+    unsigned long bad = 0;
+    cmd_parser_init(&p);
+
+    auto take = [&](unsigned long at) {
+        if (cmd.type == CMD_TIME && cmd.time.error == 0 && cmd.color >= 'A' && cmd.color <= 'Z') {
+            entries.push_back(alarm_entry_make((uint32_t)cmd.time.seconds * 1000u + cmd.ms, cmd.color));
+            return;
+        }
+        bad++;
+        if (cmd.type == CMD_TIME) {
+            fprintf(stderr, "%s:%lu: rejected (code %d)\n", in_path, at, cmd_time_value(&cmd));
+        } else {
+            fprintf(stderr, "%s:%lu: rejected (%s)\n", in_path, at,
+                    cmd.type == CMD_WORD ? "not a time command" : "malformed");
+        }
+    };
+
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (cmd_parser_feed(&p, (char)c, &cmd)) take(line);
+        if (c == '\n') line++;
+    }
+    if (cmd_parser_feed(&p, '\n', &cmd)) take(line);
+    fclose(in);
+
+    if (bad && !skip_invalid) {
+        fprintf(stderr, "%lu invalid line(s), nothing written (use --skip-invalid to drop them)\n", bad);
+        return 1;
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](uint32_t a, uint32_t b) {
+        return alarm_entry_ms(a) < alarm_entry_ms(b);
+    });
+
+    std::vector<uint8_t> image;
+    image.reserve(sizeof(struct alarm_schedule_header) + entries.size() * 4);
+    put_le32(image, ALARM_SCHEDULE_MAGIC);
+    put_le16(image, ALARM_SCHEDULE_VERSION);
+    put_le16(image, sizeof(uint32_t));
+    put_le32(image, (uint32_t)entries.size());
+    size_t crc_at = image.size();
+    put_le32(image, 0);
+    for (uint32_t e : entries) put_le32(image, e);
+
+    uint32_t crc = alarm_schedule_crc32(0, image.data(), crc_at);
+    crc = alarm_schedule_crc32(crc, image.data() + crc_at + 4, image.size() - crc_at - 4);
+    for (int i = 0; i < 4; i++) image[crc_at + i] = (uint8_t)(crc >> (8 * i));
+
+    FILE *out = fopen(out_path, "wb");
+    if (out == nullptr) {
+        perror(out_path);
+        return 2;
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), out) == image.size();
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        perror(out_path);
+        return 2;
+    }
+
+    fprintf(stderr, "%zu entries, %zu bytes, crc32 %08x%s\n", entries.size(), image.size(), crc,
+            bad ? " (invalid lines skipped)" : "");
+    return 0;
+}
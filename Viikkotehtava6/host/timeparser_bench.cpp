@@ -0,0 +1,183 @@
+/* Host microbenchmark for the TimeParser entry points.
+ *
+ * Every parser runs over the same generated inputs for each input mix and
+ * reports ns/op and items/s. Output is CSV by default, or one JSON object
+ * per line with --json, so runs of different parser revisions can be
+ * diffed or plotted. */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CommandParser.h"
+#include "TimeParser.h"
+
+namespace {
+
+constexpr size_t kInputs = 4096;
+constexpr double kMinSeconds = 0.2;
+
+enum class Mix { Valid, OutOfRange, NonNumeric, WrongLength, Mixed };
+
+const char *mix_name(Mix m)
+{
+    switch (m) {
+    case Mix::Valid:       return "valid";
+    case Mix::OutOfRange:  return "out_of_range";
+    case Mix::NonNumeric:  return "non_numeric";
+    case Mix::WrongLength: return "wrong_length";
+    case Mix::Mixed:       return "mixed";
+    }
+    return "?";
+}
+
+std::string make_input(Mix m, std::mt19937 &rng)
+{
+    char b[16];
+    auto r = [&](int n) { return (int)(rng() % (unsigned)n); };
+
+    switch (m) {
+    case Mix::Valid:
+        snprintf(b, sizeof(b), "%02d%02d%02d", r(24), r(60), 1 + r(59));
+        return b;
+    case Mix::OutOfRange:
+        switch (r(3)) {
+        case 0:  snprintf(b, sizeof(b), "%02d%02d%02d", 24 + r(76), r(60), r(60)); break;
+        case 1:  snprintf(b, sizeof(b), "%02d%02d%02d", r(24), 60 + r(40), r(60)); break;
+        default: snprintf(b, sizeof(b), "%02d%02d%02d", r(24), r(60), 60 + r(40)); break;
+        }
+        return b;
+    case Mix::NonNumeric: {
+        snprintf(b, sizeof(b), "%02d%02d%02d", r(24), r(60), r(60));
+        b[r(6)] = (char)('A' + r(26));
+        return b;
+    }
+    case Mix::WrongLength: {
+        int len = r(2) ? 1 + r(5) : 7 + r(4);
+        for (int i = 0; i < len; i++) b[i] = (char)('0' + r(10));
+        b[len] = '\0';
+        return b;
+    }
+    case Mix::Mixed:
+        return make_input((Mix)r(4), rng);
+    }
+    return "";
+}
+
+struct Result {
+    double ns_per_op;
+    double items_per_s;
+    int64_t checksum;
+};
+
+template <typename Fn>
+Result run(Fn fn)
+{
+    using clock = std::chrono::steady_clock;
+    int64_t checksum = 0;
+    int64_t sink = 0;
+    size_t items = 0;
+
+    fn(checksum);   /* warm-up; its sum identifies the results of one pass */
+
+    auto t0 = clock::now();
+    double elapsed = 0;
+    do {
+        items += fn(sink);
+        elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+    } while (elapsed < kMinSeconds);
+
+    if (sink == 1) fputc(' ', stderr);   /* keep the timed passes alive */
+    return { elapsed * 1e9 / (double)items, (double)items / elapsed, checksum };
+}
+
+void report(bool json, const char *parser, Mix m, size_t batch, const Result &r)
+{
+    if (json) {
+        printf("{\"parser\":\"%s\",\"mix\":\"%s\",\"batch\":%zu,\"ns_per_op\":%.3f,"
+               "\"items_per_s\":%.0f,\"checksum\":%lld}\n",
+               parser, mix_name(m), batch, r.ns_per_op, r.items_per_s, (long long)r.checksum);
+    } else {
+        printf("%s,%s,%zu,%.3f,%.0f,%lld\n",
+               parser, mix_name(m), batch, r.ns_per_op, r.items_per_s, (long long)r.checksum);
+    }
+    fflush(stdout);
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (!json) printf("parser,mix,batch,ns_per_op,items_per_s,checksum\n");
+
+    const Mix mixes[] = { Mix::Valid, Mix::OutOfRange, Mix::NonNumeric, Mix::WrongLength, Mix::Mixed };
+    const size_t batches[] = { 1, 8, 64, 1024, kInputs };
+
+    for (Mix m : mixes) {
+        std::mt19937 rng(12345u + (unsigned)m);
+        std::vector<std::string> lines(kInputs);
+        std::vector<const char *> ptrs(kInputs);
+        std::vector<size_t> lens(kInputs);
+        for (size_t i = 0; i < kInputs; i++) {
+            lines[i] = make_input(m, rng);
+            ptrs[i] = lines[i].c_str();
+            lens[i] = lines[i].size();
+        }
+        std::vector<int32_t> out(kInputs);
+
+        report(json, "time_parse", m, 1, run([&](int64_t &sum) {
+            for (size_t i = 0; i < kInputs; i++) sum += time_parse(ptrs[i]);
+            return kInputs;
+        }));
+
+        report(json, "time_parse_n", m, 1, run([&](int64_t &sum) {
+            for (size_t i = 0; i < kInputs; i++) sum += time_parse_n(ptrs[i], lens[i]);
+            return kInputs;
+        }));
+
+        report(json, "time_parse_ex", m, 1, run([&](int64_t &sum) {
+            struct time_result tr;
+            for (size_t i = 0; i < kInputs; i++) sum += time_parse_ex(ptrs[i], lens[i], &tr);
+            return kInputs;
+        }));
+
+        for (size_t batch : batches) {
+            report(json, "time_parse_batch", m, batch, run([&](int64_t &sum) {
+                for (size_t i = 0; i < kInputs; i += batch) {
+                    time_parse_batch(&ptrs[i], batch, &out[i]);
+                }
+                for (size_t i = 0; i < kInputs; i++) sum += out[i];
+                return kInputs;
+            }));
+        }
+
+        report(json, "cmd_parser", m, 1, run([&](int64_t &sum) {
+            struct cmd_parser p;
+            struct command cmd;
+            cmd_parser_init(&p);
+            for (size_t i = 0; i < kInputs; i++) {
+                for (size_t k = 0; k < lens[i]; k++) cmd_parser_feed(&p, ptrs[i][k], &cmd);
+                if (!cmd_parser_feed(&p, '\n', &cmd)) continue;
+                /* A leading letter makes the line a word command; time_parse()
+                 * reports the same line as not numeric. */
+                sum += cmd.type == CMD_TIME ? cmd_time_value(&cmd) : TIME_ERROR_NOT_NUMERIC;
+            }
+            return kInputs;
+        }));
+    }
+
+    return 0;
+}
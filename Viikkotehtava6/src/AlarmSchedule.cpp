@@ -0,0 +1,59 @@
+#include "AlarmSchedule.h"
+#include <string.h>
+
+/* Nibble table: small enough for flash, fast enough for boot-time checks. */
+static const uint32_t crc32_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t alarm_schedule_crc32(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+int32_t alarm_schedule_open(const void *blob, size_t size, const uint32_t **entries)
+{
+    const struct alarm_schedule_header *h = (const struct alarm_schedule_header *)blob;
+
+    if (blob == NULL || size < sizeof(*h)) {
+        return ALARM_SCHEDULE_ERROR_SIZE;
+    }
+    if (h->magic != ALARM_SCHEDULE_MAGIC) {
+        return ALARM_SCHEDULE_ERROR_MAGIC;
+    }
+    if (h->version != ALARM_SCHEDULE_VERSION || h->entry_size != sizeof(uint32_t)) {
+        return ALARM_SCHEDULE_ERROR_VERSION;
+    }
+    if (h->count > (size - sizeof(*h)) / sizeof(uint32_t) || h->count > INT32_MAX) {
+        return ALARM_SCHEDULE_ERROR_SIZE;
+    }
+
+    const uint32_t *e = (const uint32_t *)(h + 1);
+    uint32_t crc = alarm_schedule_crc32(0, h, offsetof(struct alarm_schedule_header, crc32));
+    crc = alarm_schedule_crc32(crc, e, h->count * sizeof(uint32_t));
+    if (crc != h->crc32) {
+        return ALARM_SCHEDULE_ERROR_CRC;
+    }
+
+    for (uint32_t i = 1; i < h->count; i++) {
+        if (alarm_entry_ms(e[i]) < alarm_entry_ms(e[i - 1])) {
+            return ALARM_SCHEDULE_ERROR_ORDER;
+        }
+    }
+
+    if (entries != NULL) {
+        *entries = e;
+    }
+    return (int32_t)h->count;
+}
@@ -0,0 +1,68 @@
+#ifndef ALARMSCHEDULE_H
+#define ALARMSCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Binary alarm schedule, produced on the host by schedule_compile and
+ * read in place on the target (flash or an upload buffer) without any
+ * per-entry parsing. All fields are little-endian.
+ *
+ *   struct alarm_schedule_header   16 bytes
+ *   uint32_t entries[count]        sorted by time, see ALARM_ENTRY_*
+ *
+ * crc32 is CRC-32/IEEE over the first 12 header bytes followed by the
+ * entries. */
+#define ALARM_SCHEDULE_MAGIC    0x534C5441u   /* "ATLS" */
+#define ALARM_SCHEDULE_VERSION  1u
+
+struct alarm_schedule_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_size;
+    uint32_t count;
+    uint32_t crc32;
+};
+
+/* Entry word: bits 0..26 = milliseconds after arming (HHMMSS.mmm fits),
+ * bits 27..31 = colour letter - 'A'. */
+#define ALARM_ENTRY_MS_MASK      0x07FFFFFFu
+#define ALARM_ENTRY_COLOR_SHIFT  27
+
+static inline uint32_t alarm_entry_make(uint32_t ms, char color)
+{
+    return (ms & ALARM_ENTRY_MS_MASK) | ((uint32_t)(color - 'A') << ALARM_ENTRY_COLOR_SHIFT);
+}
+
+static inline uint32_t alarm_entry_ms(uint32_t e)
+{
+    return e & ALARM_ENTRY_MS_MASK;
+}
+
+static inline char alarm_entry_color(uint32_t e)
+{
+    return (char)('A' + (e >> ALARM_ENTRY_COLOR_SHIFT));
+}
+
+#define ALARM_SCHEDULE_ERROR_SIZE     -1
+#define ALARM_SCHEDULE_ERROR_MAGIC    -2
+#define ALARM_SCHEDULE_ERROR_VERSION  -3
+#define ALARM_SCHEDULE_ERROR_CRC      -4
+#define ALARM_SCHEDULE_ERROR_ORDER    -5
+
+uint32_t alarm_schedule_crc32(uint32_t crc, const void *data, size_t len);
+
+/* Checks a schedule image in place. On success returns the entry count
+ * and points *entries into blob; otherwise returns ALARM_SCHEDULE_ERROR_*.
+ * blob must be 4-byte aligned. */
+int32_t alarm_schedule_open(const void *blob, size_t size, const uint32_t **entries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALARMSCHEDULE_H */
@@ -0,0 +1,391 @@
+#include "CommandParser.h"
+#include <string.h>
+
+enum {
+    ST_START,       /* skipping leading whitespace              */
+    ST_TIME,        /* inside HHMMSS / HH:MM:SS                 */
+    ST_MS,          /* after '.'                                */
+    ST_COLOR,       /* after '/', expecting the colour letter   */
+    ST_DURATION,    /* after "/x,", digits of the on-time in ms */
+    ST_REPEAT,      /* after '*', digits of the repeat count    */
+    ST_WORD,        /* letters of a word command                */
+    ST_ARG_SEP,     /* after ',' or ' ', skipping spaces        */
+    ST_ARG,         /* digits of the argument                   */
+    ST_PROG_STEP,   /* after "P:" or ';', expecting R/Y/G or L  */
+    ST_PROG_MS,     /* digits of a program step's on-time       */
+    ST_PROG_LOOPS,  /* digits after 'L'                         */
+    ST_TAIL,        /* only trailing whitespace may follow      */
+    ST_IGNORE,      /* rest of the line is ignored (strtoul-like) */
+    ST_BAD,         /* malformed, wait for the terminator       */
+};
+
+static inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\v' || c == '\f';
+}
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool is_alpha(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static inline char to_upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+/* acc * 10 + digit, saturating at UINT32_MAX the way strtoul() does. */
+static inline uint32_t digit_sat(uint32_t acc, char c)
+{
+    uint32_t d = (uint32_t)(c - '0');
+    return (acc > (UINT32_MAX - d) / 10) ? UINT32_MAX : acc * 10 + d;
+}
+
+void cmd_parser_init(struct cmd_parser *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->state = ST_START;
+    p->cmd.color = 'R';
+}
+
+/* One character of the time field. ':' is only a separator at the
+ * HH:MM:SS positions; anywhere else it is an ordinary non-digit. */
+static void time_field_char(struct cmd_parser *p, char c)
+{
+    if (c == ':' && (p->raw == 2 || p->raw == 5)) {
+        p->colons++;
+        p->raw++;
+        return;
+    }
+
+    uint8_t k = p->fchars++;
+    p->raw++;
+
+    if (!is_digit(c)) {
+        p->bad_char = true;
+        return;
+    }
+
+    uint8_t d = (uint8_t)(c - '0');
+    struct time_result *t = &p->cmd.time;
+    if (k < 2)      t->hh = (uint8_t)(t->hh * 10 + d);
+    else if (k < 4) t->mm = (uint8_t)(t->mm * 10 + d);
+    else if (k < 6) t->ss = (uint8_t)(t->ss * 10 + d);
+}
+
+/* Mirrors time_parse(): the length is judged first, then digits, then
+ * ranges, so the accumulators are only trusted once the whole field is
+ * known to be six digits. Without both HH:MM:SS colons the field is
+ * judged exactly as time_parse() would judge the raw characters. */
+static void time_finish(struct cmd_parser *p)
+{
+    struct time_result *t = &p->cmd.time;
+    bool hms = (p->colons == 2 && p->fchars == 6);
+
+    for (uint8_t i = p->ms_digits; i > 0 && i < 3; i++) {
+        p->cmd.ms *= 10;   /* ".5" means 500 ms */
+    }
+
+    if (!hms && p->raw != 6) {
+        t->error = TIME_ERROR_LENGTH;
+    } else if (p->bad_char || (!hms && p->colons != 0)) {
+        t->error = TIME_ERROR_NOT_NUMERIC;
+    } else if (t->hh > 23) {
+        t->error = TIME_ERROR_HOUR_RANGE;
+    } else if (t->mm > 59) {
+        t->error = TIME_ERROR_MINUTE_RANGE;
+    } else if (t->ss > 59) {
+        t->error = TIME_ERROR_SECOND_RANGE;
+    } else if (t->hh == 0 && t->mm == 0 && t->ss == 0 && p->cmd.ms == 0) {
+        t->error = TIME_ERROR_ZERO_TIME;
+    } else {
+        t->seconds = (t->hh * 3600) + (t->mm * 60) + t->ss;
+    }
+}
+
+static inline bool is_light(char c)
+{
+    return c == 'R' || c == 'Y' || c == 'G';
+}
+
+/* Adds one decimal digit to the program accumulator; false on overflow
+ * of the 27-bit step field. */
+static bool prog_digit(struct cmd_parser *p, char c)
+{
+    p->prog_acc = p->prog_acc * 10 + (uint32_t)(c - '0');
+    p->prog_digits = true;
+    return p->prog_acc <= ALARM_ENTRY_MS_MASK;
+}
+
+/* Closes the step in progress; false if it has no on-time or there is no
+ * room left for it. */
+static bool prog_end_step(struct cmd_parser *p)
+{
+    struct light_program *prog = &p->cmd.program;
+
+    if (!p->prog_digits || prog->count >= PROGRAM_STEPS_MAX) return false;
+
+    prog->steps[prog->count++] = alarm_entry_make(p->prog_acc, p->cmd.color);
+    p->prog_acc = 0;
+    p->prog_digits = false;
+    return true;
+}
+
+static inline void start_repeat(struct cmd_parser *p)
+{
+    p->cmd.repeat = true;
+    p->state = ST_REPEAT;
+}
+
+static bool finish_line(struct cmd_parser *p, struct command *out)
+{
+    bool emitted = false;
+
+    if (p->len > 0) {
+        switch (p->state) {
+        case ST_MS:
+            if (p->ms_digits == 0) {
+                p->cmd.type = CMD_MALFORMED;
+                break;
+            }
+            time_finish(p);
+            break;
+        case ST_TIME:
+        case ST_TAIL:
+        case ST_REPEAT:
+            if (p->cmd.type == CMD_TIME) time_finish(p);
+            break;
+        case ST_DURATION:
+            if (!p->cmd.has_arg) {
+                p->cmd.type = CMD_MALFORMED;
+                break;
+            }
+            time_finish(p);
+            break;
+        case ST_COLOR:
+            p->cmd.type = CMD_MALFORMED;
+            break;
+        case ST_PROG_MS:
+            if (!prog_end_step(p)) p->cmd.type = CMD_MALFORMED;
+            break;
+        case ST_PROG_LOOPS:
+            if (!p->prog_digits) {
+                p->cmd.type = CMD_MALFORMED;
+                break;
+            }
+            p->cmd.program.loops = p->prog_acc;
+            break;
+        case ST_PROG_STEP:
+            if (p->cmd.program.count == 0) p->cmd.type = CMD_MALFORMED;
+            break;
+        case ST_BAD:
+            if (p->cmd.type != CMD_TOO_LONG) p->cmd.type = CMD_MALFORMED;
+            break;
+        default:
+            break;
+        }
+        if (p->cmd.type == CMD_PROGRAM && !light_program_has_time(&p->cmd.program)) {
+            p->cmd.type = CMD_MALFORMED;
+        }
+        *out = p->cmd;
+        emitted = true;
+    }
+
+    cmd_parser_init(p);
+    return emitted;
+}
+
+bool cmd_parser_feed(struct cmd_parser *p, char c, struct command *out)
+{
+    if (c == '\r' || c == '\n') {
+        return finish_line(p, out);
+    }
+
+    if (p->state == ST_START && is_space(c)) {
+        return false;
+    }
+
+    if (p->state == ST_START && c == '!' && !p->cmd.urgent) {
+        p->cmd.urgent = true;
+        p->len++;
+        return false;
+    }
+
+    if (p->len >= CMD_LINE_MAX) {
+        p->cmd.type = CMD_TOO_LONG;
+        p->state = ST_BAD;
+        return false;
+    }
+    p->len++;
+
+    switch (p->state) {
+    case ST_START:
+        if (is_digit(c)) {
+            p->cmd.type = CMD_TIME;
+            p->state = ST_TIME;
+            time_field_char(p, c);
+        } else if (is_alpha(c)) {
+            p->cmd.type = CMD_WORD;
+            p->cmd.word[p->cmd.word_len++] = to_upper(c);
+            p->state = ST_WORD;
+        } else {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_TIME:
+        if (c == '/') {
+            p->state = ST_COLOR;
+        } else if (c == '*') {
+            start_repeat(p);
+        } else if (c == '.') {
+            p->state = ST_MS;
+        } else if (is_space(c)) {
+            p->state = ST_TAIL;
+        } else {
+            time_field_char(p, c);
+        }
+        break;
+
+    case ST_MS:
+        if (is_digit(c) && p->ms_digits < 3) {
+            p->cmd.ms = (uint16_t)(p->cmd.ms * 10 + (c - '0'));
+            p->ms_digits++;
+        } else if (c == '/' && p->ms_digits > 0) {
+            p->state = ST_COLOR;
+        } else if (c == '*' && p->ms_digits > 0) {
+            start_repeat(p);
+        } else if (is_space(c) && p->ms_digits > 0) {
+            p->state = ST_TAIL;
+        } else {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_COLOR:
+        if (is_alpha(c)) {
+            p->cmd.color = to_upper(c);
+            p->after_color = true;
+            p->state = ST_TAIL;
+        } else {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_DURATION:
+        if (is_digit(c)) {
+            p->cmd.has_arg = true;
+            p->cmd.arg = digit_sat(p->cmd.arg, c);
+        } else if (c == '*' && p->cmd.has_arg) {
+            start_repeat(p);
+        } else if (is_space(c) && p->cmd.has_arg) {
+            p->state = ST_TAIL;
+        } else {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_REPEAT:
+        if (is_digit(c)) {
+            p->cmd.repeat_count = digit_sat(p->cmd.repeat_count, c);
+        } else if (is_space(c)) {
+            p->state = ST_TAIL;
+        } else {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_WORD:
+        if (is_alpha(c)) {
+            if (p->cmd.word_len < CMD_WORD_MAX) p->cmd.word[p->cmd.word_len++] = to_upper(c);
+        } else if (c == ',' || is_space(c)) {
+            p->state = ST_ARG_SEP;
+        } else if (is_digit(c)) {
+            p->cmd.has_arg = true;
+            p->cmd.arg = (uint32_t)(c - '0');
+            p->state = ST_ARG;
+        } else if (c == ':' && p->cmd.word_len == 1 && p->cmd.word[0] == 'P') {
+            p->cmd.type = CMD_PROGRAM;
+            p->cmd.program.loops = 1;
+            p->state = ST_PROG_STEP;
+        } else {
+            p->state = ST_IGNORE;
+        }
+        break;
+
+    case ST_PROG_STEP:
+        c = to_upper(c);
+        if (is_light(c)) {
+            p->cmd.color = c;
+            p->state = ST_PROG_MS;
+        } else if (c == 'L' && p->cmd.program.count > 0) {
+            p->state = ST_PROG_LOOPS;
+        } else if (!is_space(c)) {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_PROG_MS:
+        if (is_digit(c)) {
+            if (!prog_digit(p, c)) p->state = ST_BAD;
+        } else if (c == ';' && prog_end_step(p)) {
+            p->state = ST_PROG_STEP;
+        } else {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_PROG_LOOPS:
+        if (is_digit(c)) {
+            if (!prog_digit(p, c)) p->state = ST_BAD;
+        } else if (is_space(c) && p->prog_digits) {
+            p->cmd.program.loops = p->prog_acc;
+            p->state = ST_TAIL;
+        } else {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_ARG_SEP:
+        if (is_digit(c)) {
+            p->cmd.has_arg = true;
+            p->cmd.arg = (uint32_t)(c - '0');
+            p->state = ST_ARG;
+        } else if (!is_space(c)) {
+            /* "R,abc" behaves like strtoul() did: a zero duration */
+            p->cmd.has_arg = true;
+            p->state = ST_IGNORE;
+        }
+        break;
+
+    case ST_ARG:
+        if (is_digit(c)) {
+            p->cmd.arg = digit_sat(p->cmd.arg, c);
+        } else {
+            p->state = ST_IGNORE;
+        }
+        break;
+
+    case ST_TAIL:
+        if (c == ',' && p->after_color && !p->cmd.has_arg) {
+            p->state = ST_DURATION;
+        } else if (c == '*' && !p->cmd.repeat && p->cmd.type == CMD_TIME) {
+            start_repeat(p);
+        } else if (!is_space(c)) {
+            p->state = ST_BAD;
+        }
+        break;
+
+    case ST_IGNORE:
+    case ST_BAD:
+    default:
+        break;
+    }
+
+    return false;
+}
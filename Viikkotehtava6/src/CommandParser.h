@@ -0,0 +1,110 @@
+#ifndef COMMANDPARSER_H
+#define COMMANDPARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "TimeParser.h"
+#include "AlarmSchedule.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest line accepted, same limit as the old uart_task line buffer. */
+#define CMD_LINE_MAX  63
+#define CMD_WORD_MAX  8
+
+/* The most steps a line can hold: "P:" and then the shortest steps,
+ * "R0;" each, the last one without its ';' (20 for a 63 character line). */
+#define PROGRAM_STEPS_MAX  ((CMD_LINE_MAX - 1) / 3)
+
+/* A compiled light program. Each step is an alarm_entry_make() word
+ * (on-time in ms and colour), so running it needs no parsing. */
+struct light_program {
+    uint8_t count;
+    uint32_t loops;                      /* passes through the steps, 0 = forever */
+    uint32_t steps[PROGRAM_STEPS_MAX];
+};
+
+/* False if every step is 0 ms; such a program, looped, would never
+ * give the dispatcher a moment off, so it is rejected. */
+static inline bool light_program_has_time(const struct light_program *prog)
+{
+    for (uint8_t i = 0; i < prog->count; i++) {
+        if (alarm_entry_ms(prog->steps[i]) != 0) return true;
+    }
+    return false;
+}
+
+enum cmd_type {
+    CMD_NONE = 0,
+    CMD_TIME,        /* HHMMSS[.mmm][/x[,dur]][*N], HH:MM:SS also works */
+    CMD_WORD,        /* R,1000  A1  or any WORD[,n] / WORD n keyword  */
+    CMD_MALFORMED,   /* anything else                                  */
+    CMD_TOO_LONG,    /* more than CMD_LINE_MAX characters              */
+    CMD_PROGRAM,     /* P:R2000;Y500;G2000[;L5]                        */
+};
+
+struct command {
+    enum cmd_type type;
+
+    /* CMD_TIME: time.error is 0 or the TIME_ERROR_* code time_parse()
+     * would return for the six digits. A ",dur" after the colour is
+     * returned in has_arg/arg, a "*N" repeat in repeat/repeat_count
+     * ("*" or "*0" = repeat forever). */
+    struct time_result time;
+    uint16_t ms;
+    char color;
+    bool repeat;
+    uint32_t repeat_count;
+
+    /* CMD_WORD: upper-cased word, truncated to CMD_WORD_MAX letters,
+     * and its optional numeric argument. */
+    char word[CMD_WORD_MAX + 1];
+    uint8_t word_len;
+    bool has_arg;
+    uint32_t arg;
+
+    /* CMD_PROGRAM: steps compiled as the line arrives. Colours are
+     * R, Y and G; "L<n>" may only come last and defaults to 1. */
+    struct light_program program;
+
+    /* a leading '!' marks the command urgent (emergency lane) */
+    bool urgent;
+};
+
+/* Resumable line parser. Feed it one received byte at a time; every
+ * field is validated and accumulated as the byte arrives, so nothing is
+ * buffered and nothing is rescanned when the terminator shows up. */
+struct cmd_parser {
+    uint8_t state;
+    uint8_t len;         /* bytes of the current line, after leading spaces */
+    uint8_t fchars;      /* time field characters, separator colons excluded */
+    uint8_t raw;         /* time field characters, separator colons included */
+    uint8_t colons;
+    uint8_t ms_digits;
+    bool bad_char;
+    bool after_color;
+    bool prog_digits;    /* current program number has at least one digit */
+    uint32_t prog_acc;   /* current program step on-time or loop count */
+    struct command cmd;
+};
+
+void cmd_parser_init(struct cmd_parser *p);
+
+/* Returns true when c terminated a non-empty line; *out then holds the
+ * finished command and the parser is ready for the next line. */
+bool cmd_parser_feed(struct cmd_parser *p, char c, struct command *out);
+
+/* Seconds or TIME_ERROR_* code, i.e. what time_parse() returns. */
+static inline int cmd_time_value(const struct command *c)
+{
+    return c->time.error ? c->time.error : c->time.seconds;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMANDPARSER_H */
@@ -0,0 +1,109 @@
+#include "FrameCodec.h"
+#include <string.h>
+
+/* Nibble table for poly 0x1021, MSB first. */
+static const uint16_t crc16_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t frame_crc16(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (len--) {
+        uint8_t b = *p++;
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble[((crc >> 12) ^ (b >> 4)) & 0x0F]);
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble[((crc >> 12) ^ b) & 0x0F]);
+    }
+    return crc;
+}
+
+size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_at = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[o++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        }
+    }
+    out[code_at] = code;
+    return o;
+}
+
+int cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t cap)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len || o + code - 1 > cap) {
+            return -1;
+        }
+
+        /* o never passes i, so this is safe in place */
+        for (uint8_t k = 1; k < code; k++) {
+            out[o++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {
+            if (o >= cap) return -1;
+            out[o++] = 0;
+        }
+    }
+    return (int)o;
+}
+
+size_t frame_encode(uint8_t seq, uint8_t type, const void *payload, size_t len,
+                    uint8_t *out, size_t cap)
+{
+    uint8_t body[FRAME_BODY_MAX];
+
+    if (len > FRAME_PAYLOAD_MAX || cap < len + 4 + (len + 4) / 254 + 1 + 2) {
+        return 0;
+    }
+
+    body[0] = seq;
+    body[1] = type;
+    if (len > 0) memcpy(&body[2], payload, len);
+    uint16_t crc = frame_crc16(0xFFFF, body, len + 2);
+    body[len + 2] = (uint8_t)crc;
+    body[len + 3] = (uint8_t)(crc >> 8);
+
+    out[0] = 0;
+    size_t n = cobs_encode(body, len + 4, &out[1]);
+    out[n + 1] = 0;
+    return n + 2;
+}
+
+int frame_decode(uint8_t *buf, size_t len, struct frame *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    int n = cobs_decode(buf, len, buf, FRAME_BODY_MAX);
+    if (n >= 2) {
+        out->seq = buf[0];
+        out->type = buf[1];
+    }
+    if (n < 4) {
+        return FRAME_STATUS_BAD_FRAME;
+    }
+
+    uint16_t crc = (uint16_t)(buf[n - 2] | (buf[n - 1] << 8));
+    if (frame_crc16(0xFFFF, buf, (size_t)n - 2) != crc) {
+        return FRAME_STATUS_BAD_CRC;
+    }
+
+    out->payload = &buf[2];
+    out->len = (size_t)n - 4;
+    return FRAME_STATUS_OK;
+}
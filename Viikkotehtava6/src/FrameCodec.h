@@ -0,0 +1,97 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Binary command frames, sent on the same UART as the text commands.
+ *
+ *   0x00  COBS( seq  type  payload...  crc16 )  0x00
+ *
+ * COBS removes every zero byte from the frame body, so 0x00 only ever
+ * marks frame boundaries; text lines never contain it, which is how the
+ * receiver tells the two apart. The leading 0x00 is required. crc16 is
+ * CRC-16/CCITT-FALSE over seq, type and payload, little-endian. All
+ * multi-byte payload fields are little-endian.
+ *
+ * A reply has the request's seq, its type | FRAME_REPLY and a payload
+ * that starts with a FRAME_STATUS_* byte. */
+#define FRAME_PAYLOAD_MAX  240
+#define FRAME_BODY_MAX     (2 + FRAME_PAYLOAD_MAX + 2)
+/* COBS adds one byte per 254, plus the two delimiters. */
+#define FRAME_WIRE_MAX     (FRAME_BODY_MAX + FRAME_BODY_MAX / 254 + 1 + 2)
+
+#define FRAME_REPLY  0x80
+
+enum frame_type {
+    FRAME_COLOR    = 0x01,  /* u8 flags (bit 0 = urgent), then 1.. { u8 colour, u32 ms } */
+    FRAME_ALARM    = 0x02,  /* u32 delay_ms, u8 colour, u32 ms, u32 count (0 = one shot, else repeats; 0xFFFFFFFF = forever) */
+    FRAME_PROGRAM  = 0x03,  /* u32 loops (0 = forever), then 1.. u32 alarm_entry_make() steps */
+    FRAME_QUERY    = 0x04,  /* empty */
+    FRAME_SCHEDULE = 0x05,  /* an alarm_schedule image, as written by schedule_compile */
+};
+
+/* A schedule is uploaded in a single frame, so an image can hold at most
+ * this many entries after its 16 byte header. Each upload replaces the
+ * running schedule and restarts its timeline, so a longer image cannot be
+ * sent in parts; it has to be linked into flash at build time instead
+ * (west build -- -DALARM_SCHEDULE_BIN=path). */
+#define FRAME_SCHEDULE_ENTRIES_MAX  ((FRAME_PAYLOAD_MAX - 16) / 4)
+
+enum frame_status {
+    FRAME_STATUS_OK = 0,
+    FRAME_STATUS_BAD_FRAME,     /* COBS error, too short or too long */
+    FRAME_STATUS_BAD_CRC,
+    FRAME_STATUS_BAD_TYPE,
+    FRAME_STATUS_BAD_ARG,
+    FRAME_STATUS_BUSY,          /* a queue or table was full */
+};
+
+struct frame {
+    uint8_t seq;
+    uint8_t type;
+    const uint8_t *payload;
+    size_t len;
+};
+
+uint16_t frame_crc16(uint16_t crc, const void *data, size_t len);
+
+/* out needs len + len / 254 + 1 bytes. Returns the encoded length. */
+size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/* May decode in place (out == in). Returns the decoded length, or -1 if
+ * the input is not valid COBS or does not fit in cap. */
+int cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t cap);
+
+/* Builds a complete frame, delimiters included. Returns the wire length,
+ * or 0 if the payload is longer than FRAME_PAYLOAD_MAX or cap is short. */
+size_t frame_encode(uint8_t seq, uint8_t type, const void *payload, size_t len,
+                    uint8_t *out, size_t cap);
+
+/* Decodes the bytes between two delimiters in place and checks the CRC.
+ * Returns a FRAME_STATUS_* code; seq and type are filled in whenever the
+ * frame was long enough to carry them, so the sender can be answered. */
+int frame_decode(uint8_t *buf, size_t len, struct frame *out);
+
+static inline uint32_t frame_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void frame_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAMECODEC_H */
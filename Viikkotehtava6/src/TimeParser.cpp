@@ -3,7 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-int time_parse(char *time)
+int time_parse(const char *time)
 {
     if (time == NULL) {
         return TIME_ERROR_NULL;
@@ -35,4 +35,173 @@ int time_parse(char *time)
 
     int total_seconds = (hh * 3600) + (mm * 60) + ss;
     return total_seconds;
-}
\ No newline at end of file
+}
+
+/* ---------- SWAR batch parser ---------- */
+/* Byte lanes 0..5 hold the six characters, lane 0 = first character. */
+#define SWAR_LANES    0x0000FFFFFFFFFFFFULL
+#define SWAR_HIGH     0x0000808080808080ULL
+#define SWAR_ZEROS    0x0000303030303030ULL
+#define SWAR_ABOVE_9  0x0000464646464646ULL   /* 0x80 - ':' */
+#define SWAR_PAIR_LO  0x000000FF00FF00FFULL
+
+/* After pairing, 16-bit lanes hold hh, mm, ss. Adding (0x8000 - limit - 1)
+ * sets the lane's top bit exactly when the value is over its limit. */
+#define SWAR_LIMITS   ((uint64_t)(0x8000 - 24) | \
+                       ((uint64_t)(0x8000 - 60) << 16) | \
+                       ((uint64_t)(0x8000 - 60) << 32))
+
+/* Returns 0 or a TIME_ERROR_* code; *pairs gets hh, mm, ss in 16-bit
+ * lanes whenever all six bytes were digits. */
+static inline int32_t time_check_word(uint64_t w, uint64_t *pairs)
+{
+    /* Non-digit: byte has bit 7 set, is above '9', or is below '0'. */
+    if ((w | (w + SWAR_ABOVE_9) | (w - SWAR_ZEROS)) & SWAR_HIGH) {
+        return TIME_ERROR_NOT_NUMERIC;
+    }
+
+    uint64_t d = w - SWAR_ZEROS;
+    uint64_t v = (d & SWAR_PAIR_LO) * 10 + ((d >> 8) & SWAR_PAIR_LO);
+    *pairs = v;
+
+    uint64_t over = v + SWAR_LIMITS;
+    if (over & 0x8000ULL)         return TIME_ERROR_HOUR_RANGE;
+    if (over & 0x80000000ULL)     return TIME_ERROR_MINUTE_RANGE;
+    if (over & 0x800000000000ULL) return TIME_ERROR_SECOND_RANGE;
+
+    if (v == 0) return TIME_ERROR_ZERO_TIME;
+
+    return 0;
+}
+
+static inline int32_t time_pairs_to_seconds(uint64_t v)
+{
+    int32_t hh = (int32_t)(v & 0xFF);
+    int32_t mm = (int32_t)((v >> 16) & 0xFF);
+    int32_t ss = (int32_t)((v >> 32) & 0xFF);
+    return (hh * 3600) + (mm * 60) + ss;
+}
+
+static inline int32_t time_parse_word(uint64_t w)
+{
+    uint64_t v = 0;
+    int32_t err = time_check_word(w, &v);
+    if (err) return err;
+
+    return time_pairs_to_seconds(v);
+}
+
+static inline uint64_t time_load_word(const char *p)
+{
+    uint64_t w = 0;
+    memcpy(&w, p, 6);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    w = __builtin_bswap64(w);
+#endif
+    return w & SWAR_LANES;
+}
+
+void time_parse_batch(const char *const *in, size_t n, int32_t *out)
+{
+    if (in == NULL || out == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const char *p = in[i];
+        if (p == NULL) {
+            out[i] = TIME_ERROR_NULL;
+            continue;
+        }
+
+        /* strlen(p) == 6 without walking past the 7th byte */
+        size_t len = 0;
+        while (len < 7 && p[len] != '\0') len++;
+        if (len != 6) {
+            out[i] = TIME_ERROR_LENGTH;
+            continue;
+        }
+
+        out[i] = time_parse_word(time_load_word(p));
+    }
+}
+
+int time_parse_n(const char *p, size_t len)
+{
+    if (p == NULL) {
+        return TIME_ERROR_NULL;
+    }
+
+    if (len != 6) {
+        return TIME_ERROR_LENGTH;
+    }
+
+    return time_parse_word(time_load_word(p));
+}
+
+int time_parse_ex(const char *p, size_t len, struct time_result *out)
+{
+    struct time_result r = { 0, 0, 0, 0, 0 };
+
+    if (p == NULL) {
+        r.error = TIME_ERROR_NULL;
+    } else if (len != 6) {
+        r.error = TIME_ERROR_LENGTH;
+    } else {
+        uint64_t v = 0;
+        r.error = (int8_t)time_check_word(time_load_word(p), &v);
+        r.hh = (uint8_t)(v & 0xFF);
+        r.mm = (uint8_t)((v >> 16) & 0xFF);
+        r.ss = (uint8_t)((v >> 32) & 0xFF);
+        if (r.error == 0) {
+            r.seconds = time_pairs_to_seconds(v);
+        }
+    }
+
+    if (out != NULL) {
+        *out = r;
+    }
+    return r.error ? r.error : r.seconds;
+}
+
+/* ---------- Formatter ---------- */
+static const char digit_pairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9',
+};
+
+size_t time_format(int32_t seconds, char *buf, size_t cap, enum time_format_style style)
+{
+    size_t need = (style == TIME_FORMAT_HH_MM_SS) ? 8 : 6;
+
+    if (buf == NULL || cap < need + 1) {
+        return 0;
+    }
+    if (seconds < 0 || seconds >= 24 * 3600) {
+        buf[0] = '\0';
+        return 0;
+    }
+
+    uint32_t s = (uint32_t)seconds;
+    const char *hh = &digit_pairs[(s / 3600) * 2];
+    const char *mm = &digit_pairs[((s / 60) % 60) * 2];
+    const char *ss = &digit_pairs[(s % 60) * 2];
+
+    char *o = buf;
+    *o++ = hh[0]; *o++ = hh[1];
+    if (style == TIME_FORMAT_HH_MM_SS) *o++ = ':';
+    *o++ = mm[0]; *o++ = mm[1];
+    if (style == TIME_FORMAT_HH_MM_SS) *o++ = ':';
+    *o++ = ss[0]; *o++ = ss[1];
+    *o = '\0';
+
+    return need;
+}
@@ -1,6 +1,9 @@
 #ifndef TIMEPARSER_H
 #define TIMEPARSER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,7 +16,40 @@ extern "C" {
 #define TIME_ERROR_SECOND_RANGE   -6
 #define TIME_ERROR_ZERO_TIME      -7
 
-int time_parse(char *time);
+/* Parse result with the fields kept apart. error is 0 or TIME_ERROR_*;
+ * hh/mm/ss are filled whenever all six characters were digits. */
+struct time_result {
+    int32_t seconds;
+    int8_t  error;
+    uint8_t hh;
+    uint8_t mm;
+    uint8_t ss;
+};
+
+enum time_format_style {
+    TIME_FORMAT_HHMMSS,     /* "000120"   */
+    TIME_FORMAT_HH_MM_SS,   /* "00:01:20" */
+};
+
+int time_parse(const char *time);
+
+/* Same rules as time_parse(), but on exactly len bytes at p. The buffer
+ * does not need to be NUL-terminated, so a receive buffer or ring-buffer
+ * slice can be parsed in place. */
+int time_parse_n(const char *p, size_t len);
+
+/* time_parse_n() that also fills *out. Returns the same value. */
+int time_parse_ex(const char *p, size_t len, struct time_result *out);
+
+/* Writes seconds (0..86399) as HHMMSS or HH:MM:SS plus a terminator.
+ * Returns the number of characters written, or 0 if the value is out of
+ * range or buf is too small (7 or 9 bytes are needed). */
+size_t time_format(int32_t seconds, char *buf, size_t cap, enum time_format_style style);
+
+/* Parses n HHMMSS strings at once. out[i] receives exactly what
+ * time_parse(in[i]) would return, but each field is checked as one
+ * 64-bit word instead of byte by byte. */
+void time_parse_batch(const char *const *in, size_t n, int32_t *out);
 
 #ifdef __cplusplus
 }
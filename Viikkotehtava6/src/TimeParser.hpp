@@ -0,0 +1,72 @@
+#ifndef TIMEPARSER_HPP
+#define TIMEPARSER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "TimeParser.h"
+
+/* Header-only constexpr twin of time_parse_ex(). Same rules, same error
+ * codes, but usable in constant expressions so built-in alarm tables are
+ * validated and converted to seconds by the compiler. */
+namespace timeparser {
+
+constexpr time_result parse_hhmmss(const char *s, size_t len)
+{
+    time_result r{};
+
+    if (s == nullptr) {
+        r.error = TIME_ERROR_NULL;
+        return r;
+    }
+    if (len != 6) {
+        r.error = TIME_ERROR_LENGTH;
+        return r;
+    }
+    for (size_t i = 0; i < 6; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            r.error = TIME_ERROR_NOT_NUMERIC;
+            return r;
+        }
+    }
+
+    r.hh = (uint8_t)((s[0] - '0') * 10 + (s[1] - '0'));
+    r.mm = (uint8_t)((s[2] - '0') * 10 + (s[3] - '0'));
+    r.ss = (uint8_t)((s[4] - '0') * 10 + (s[5] - '0'));
+
+    if (r.hh > 23) r.error = TIME_ERROR_HOUR_RANGE;
+    else if (r.mm > 59) r.error = TIME_ERROR_MINUTE_RANGE;
+    else if (r.ss > 59) r.error = TIME_ERROR_SECOND_RANGE;
+    else if (r.hh == 0 && r.mm == 0 && r.ss == 0) r.error = TIME_ERROR_ZERO_TIME;
+    else r.seconds = (r.hh * 3600) + (r.mm * 60) + r.ss;
+
+    return r;
+}
+
+template <size_t N>
+constexpr time_result parse_hhmmss(const char (&s)[N])
+{
+    return parse_hhmmss(s, N - 1);
+}
+
+/* Not constexpr on purpose: reaching it during constant evaluation is a
+ * compile error that names the problem. */
+inline int32_t hhmmss_literal_is_invalid(int32_t code)
+{
+    return code;
+}
+
+namespace literals {
+
+/* "000120"_hhmmss == 80. Use it to initialise constexpr objects so that a
+ * bad constant fails the build instead of the alarm at runtime. */
+constexpr int32_t operator""_hhmmss(const char *s, size_t len)
+{
+    return parse_hhmmss(s, len).error == 0
+        ? parse_hhmmss(s, len).seconds
+        : hhmmss_literal_is_invalid(parse_hhmmss(s, len).error);
+}
+
+} /* namespace literals */
+} /* namespace timeparser */
+
+#endif /* TIMEPARSER_HPP */
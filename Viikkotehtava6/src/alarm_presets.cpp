@@ -0,0 +1,19 @@
+#include "alarm_presets.h"
+#include "TimeParser.hpp"
+
+using namespace timeparser::literals;
+
+static_assert("000120"_hhmmss == 80, "constexpr parser disagrees with time_parse()");
+static_assert(timeparser::parse_hhmmss("001067").error == TIME_ERROR_SECOND_RANGE,
+              "constexpr parser disagrees with time_parse()");
+
+/* A typo here (e.g. "000075") is a build error, not a boot-time one. */
+static constexpr struct alarm_preset preset_table[] = {
+    { "000005"_hhmmss, 'R' },
+    { "000010"_hhmmss, 'Y' },
+    { "000100"_hhmmss, 'G' },
+    { "010000"_hhmmss, 'R' },
+};
+
+extern "C" const struct alarm_preset *const alarm_presets = preset_table;
+extern "C" const size_t alarm_preset_count = sizeof(preset_table) / sizeof(preset_table[0]);
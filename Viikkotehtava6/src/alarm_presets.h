@@ -0,0 +1,25 @@
+#ifndef ALARM_PRESETS_H
+#define ALARM_PRESETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct alarm_preset {
+    int32_t seconds;
+    char color;
+};
+
+/* Built-in alarms, selected over UART with A<n>. The table is checked
+ * and converted to seconds at compile time (see alarm_presets.cpp). */
+extern const struct alarm_preset *const alarm_presets;
+extern const size_t alarm_preset_count;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALARM_PRESETS_H */
@@ -0,0 +1,234 @@
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include "alarm_sched.h"
+
+#define CAPACITY   CONFIG_ALARM_SCHED_CAPACITY
+#define NOT_QUEUED 0xFFFF
+
+BUILD_ASSERT(CAPACITY > 0 && CAPACITY < NOT_QUEUED, "alarm slot index must fit in 16 bits");
+
+struct alarm_slot {
+    int64_t due_ms;
+    uint32_t duration_ms;
+    uint32_t period_ms;   /* 0 = one-shot */
+    uint32_t remaining;   /* firings left when periodic, 0 = forever */
+    uint16_t heap_pos;    /* NOT_QUEUED when the slot is free */
+    char color;
+};
+
+static struct alarm_slot slots[CAPACITY];
+static uint16_t heap[CAPACITY];        /* slot indexes, min-heap on due_ms */
+static uint16_t free_list[CAPACITY];   /* stack of free slot indexes */
+static uint16_t heap_len;
+static uint16_t free_len;
+
+static struct k_spinlock lock;
+static struct k_timer sched_timer;
+static alarm_fire_t fire_cb;
+
+/* ---------- Heap helpers (lock held) ---------- */
+static inline bool earlier(uint16_t a, uint16_t b)
+{
+    return slots[heap[a]].due_ms < slots[heap[b]].due_ms;
+}
+
+static inline void heap_swap(uint16_t a, uint16_t b)
+{
+    uint16_t t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+    slots[heap[a]].heap_pos = a;
+    slots[heap[b]].heap_pos = b;
+}
+
+static void sift_up(uint16_t i)
+{
+    while (i > 0) {
+        uint16_t parent = (uint16_t)((i - 1) / 2);
+        if (!earlier(i, parent)) break;
+        heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void sift_down(uint16_t i)
+{
+    while (1) {
+        /* 32 bits: 2 * i + 2 overflows uint16_t above 32766 */
+        uint32_t l = 2u * i + 1;
+        uint32_t r = l + 1;
+        uint16_t m = i;
+
+        if (l < heap_len && earlier((uint16_t)l, m)) m = (uint16_t)l;
+        if (r < heap_len && earlier((uint16_t)r, m)) m = (uint16_t)r;
+        if (m == i) break;
+        heap_swap(i, m);
+        i = m;
+    }
+}
+
+static void heap_remove(uint16_t pos)
+{
+    uint16_t slot = heap[pos];
+    uint16_t last = --heap_len;
+
+    if (pos != last) {
+        heap[pos] = heap[last];
+        slots[heap[pos]].heap_pos = pos;
+        sift_down(pos);
+        sift_up(pos);
+    }
+
+    slots[slot].heap_pos = NOT_QUEUED;
+    free_list[free_len++] = slot;
+}
+
+/* Keeps the one kernel timer pointed at the earliest alarm. */
+static void rearm_timer(void)
+{
+    if (heap_len == 0) {
+        k_timer_stop(&sched_timer);
+        return;
+    }
+    k_timer_start(&sched_timer, K_TIMEOUT_ABS_MS(slots[heap[0]].due_ms), K_NO_WAIT);
+}
+
+/* ---------- Timer ---------- */
+static void sched_expiry(struct k_timer *timer_id)
+{
+    ARG_UNUSED(timer_id);
+
+    while (1) {
+        k_spinlock_key_t key = k_spin_lock(&lock);
+
+        if (heap_len == 0 || slots[heap[0]].due_ms > k_uptime_get()) {
+            rearm_timer();
+            k_spin_unlock(&lock, key);
+            return;
+        }
+
+        uint16_t slot = heap[0];
+        struct alarm_slot *a = &slots[slot];
+        char color = a->color;
+        uint32_t duration_ms = a->duration_ms;
+
+        if (a->period_ms != 0 && a->remaining != 1) {
+            /* next deadline from the previous one: no drift */
+            if (a->remaining > 1) a->remaining--;
+            a->due_ms += a->period_ms;
+            sift_down(0);
+        } else {
+            heap_remove(0);
+        }
+
+        k_spin_unlock(&lock, key);
+
+        if (fire_cb) fire_cb(slot + 1, color, duration_ms);
+    }
+}
+
+/* ---------- API ---------- */
+void alarm_sched_init(alarm_fire_t fire)
+{
+    fire_cb = fire;
+    heap_len = 0;
+    free_len = 0;
+    for (int i = CAPACITY - 1; i >= 0; i--) {
+        slots[i].heap_pos = NOT_QUEUED;
+        free_list[free_len++] = (uint16_t)i;
+    }
+    k_timer_init(&sched_timer, sched_expiry, NULL);
+}
+
+static int arm(uint32_t delay_ms, uint32_t period_ms, uint32_t count, char color, uint32_t duration_ms)
+{
+    int64_t due = k_uptime_get() + delay_ms;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (free_len == 0) {
+        k_spin_unlock(&lock, key);
+        return -ENOMEM;
+    }
+
+    uint16_t slot = free_list[--free_len];
+    slots[slot].due_ms = due;
+    slots[slot].duration_ms = duration_ms;
+    slots[slot].period_ms = period_ms;
+    slots[slot].remaining = count;
+    slots[slot].color = color;
+
+    uint16_t pos = heap_len++;
+    heap[pos] = slot;
+    slots[slot].heap_pos = pos;
+    sift_up(pos);
+
+    if (heap[0] == slot) rearm_timer();
+
+    k_spin_unlock(&lock, key);
+    return slot + 1;
+}
+
+int alarm_sched_arm(uint32_t delay_ms, char color, uint32_t duration_ms)
+{
+    return arm(delay_ms, 0, 1, color, duration_ms);
+}
+
+int alarm_sched_arm_periodic(uint32_t period_ms, uint32_t count, char color, uint32_t duration_ms)
+{
+    if (period_ms == 0) return -EINVAL;
+    return arm(period_ms, period_ms, count, color, duration_ms);
+}
+
+int alarm_sched_cancel(int id)
+{
+    if (id < 1 || id > CAPACITY) return -ENOENT;
+
+    uint16_t slot = (uint16_t)(id - 1);
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    uint16_t pos = slots[slot].heap_pos;
+    if (pos == NOT_QUEUED) {
+        k_spin_unlock(&lock, key);
+        return -ENOENT;
+    }
+
+    heap_remove(pos);
+    if (pos == 0) rearm_timer();
+
+    k_spin_unlock(&lock, key);
+    return 0;
+}
+
+void alarm_sched_cancel_all(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    while (heap_len > 0) heap_remove((uint16_t)(heap_len - 1));
+    rearm_timer();
+
+    k_spin_unlock(&lock, key);
+}
+
+unsigned alarm_sched_pending(void)
+{
+    return heap_len;
+}
+
+bool alarm_sched_next_info(int after_id, struct alarm_info *out)
+{
+    for (int slot = after_id < 0 ? 0 : after_id; slot < CAPACITY; slot++) {
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        bool used = slots[slot].heap_pos != NOT_QUEUED;
+        if (used) {
+            out->id = slot + 1;
+            out->color = slots[slot].color;
+            out->duration_ms = slots[slot].duration_ms;
+            out->due_ms = slots[slot].due_ms;
+            out->period_ms = slots[slot].period_ms;
+            out->remaining = slots[slot].remaining;
+        }
+        k_spin_unlock(&lock, key);
+        if (used) return true;
+    }
+    return false;
+}
@@ -0,0 +1,48 @@
+#ifndef ALARM_SCHED_H
+#define ALARM_SCHED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Many pending alarms on one kernel timer. Alarms sit in a binary
+ * min-heap keyed by absolute uptime, the timer is always armed for the
+ * heap top, and arm/cancel are O(log n). Capacity is fixed at build time
+ * (CONFIG_ALARM_SCHED_CAPACITY), nothing is allocated at runtime. */
+
+/* Called from the timer ISR for every alarm that comes due. */
+typedef void (*alarm_fire_t)(int id, char color, uint32_t duration_ms);
+
+struct alarm_info {
+    int id;
+    char color;
+    uint32_t duration_ms;
+    int64_t due_ms;       /* absolute, k_uptime_get() based */
+    uint32_t period_ms;   /* 0 for a one-shot alarm */
+    uint32_t remaining;   /* firings left, 0 = forever */
+};
+
+void alarm_sched_init(alarm_fire_t fire);
+
+/* Returns the new alarm id (>= 1) or -ENOMEM when the table is full. */
+int alarm_sched_arm(uint32_t delay_ms, char color, uint32_t duration_ms);
+
+/* Recurring alarm: first fires after period_ms, then every period_ms for
+ * count firings in total (0 = until cancelled). Each deadline is the
+ * previous deadline plus the period, never "now" plus the period, so
+ * ISR latency does not accumulate into drift. Returns the id, -EINVAL
+ * for a zero period or -ENOMEM when the table is full. */
+int alarm_sched_arm_periodic(uint32_t period_ms, uint32_t count, char color, uint32_t duration_ms);
+
+/* Returns 0, or -ENOENT if id is not pending. */
+int alarm_sched_cancel(int id);
+
+void alarm_sched_cancel_all(void);
+
+unsigned alarm_sched_pending(void);
+
+/* Iterates pending alarms in id order: pass 0 first, then the previous
+ * id. Returns false when there are no more. */
+bool alarm_sched_next_info(int after_id, struct alarm_info *out);
+
+#endif /* ALARM_SCHED_H */
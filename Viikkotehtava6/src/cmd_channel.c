@@ -0,0 +1,104 @@
+#include <errno.h>
+#include "cmd_channel.h"
+
+bool cmd_channel_push(struct cmd_channel *ch, const struct light_cmd *cmd)
+{
+    bool waited = false;
+
+    while (1) {
+        k_spinlock_key_t key = k_spin_lock(&ch->lock);
+
+        uint32_t head = (uint32_t)atomic_get(&ch->head);
+        uint32_t tail = (uint32_t)atomic_get(&ch->tail);
+        uint32_t depth = head - tail;
+
+        if (depth > ch->mask && ch->policy == CMD_OVERFLOW_DROP_OLDEST) {
+            /* fails only if the consumer freed the slot in the meantime */
+            if (atomic_cas(&ch->tail, (atomic_val_t)tail, (atomic_val_t)(tail + 1))) {
+                atomic_inc(&ch->evicted);
+            }
+            depth = head - (uint32_t)atomic_get(&ch->tail);
+        }
+
+        if (depth > ch->mask) {
+            k_spin_unlock(&ch->lock, key);
+
+            if (ch->policy == CMD_OVERFLOW_BLOCK && !k_is_in_isr()) {
+                if (!waited) {
+                    atomic_inc(&ch->blocked);
+                    waited = true;
+                }
+                k_sem_take(&ch->space, K_FOREVER);
+                continue;
+            }
+
+            atomic_inc(&ch->dropped);
+            return false;
+        }
+
+        ch->buf[head & ch->mask] = *cmd;
+        atomic_set(&ch->head, (atomic_val_t)(head + 1));   /* publish after the copy */
+
+        if ((atomic_val_t)(depth + 1) > atomic_get(&ch->high_water)) {
+            atomic_set(&ch->high_water, (atomic_val_t)(depth + 1));
+        }
+
+        k_spin_unlock(&ch->lock, key);
+
+        k_sem_give(ch->items);
+        return true;
+    }
+}
+
+bool cmd_channel_read(struct cmd_channel *ch, struct light_cmd *out)
+{
+    uint32_t tail;
+
+    do {
+        tail = (uint32_t)atomic_get(&ch->tail);
+        if (tail == (uint32_t)atomic_get(&ch->head)) {
+            return false;
+        }
+        *out = ch->buf[tail & ch->mask];
+        /* release the slot after the copy; losing the race means a
+         * DROP_OLDEST push evicted it, so read the next one instead */
+    } while (!atomic_cas(&ch->tail, (atomic_val_t)tail, (atomic_val_t)(tail + 1)));
+
+    if (ch->policy == CMD_OVERFLOW_BLOCK) {
+        k_sem_give(&ch->space);
+    }
+    return true;
+}
+
+bool cmd_channel_read_if(struct cmd_channel *ch, cmd_channel_pred_t pred, void *arg,
+                         struct light_cmd *out)
+{
+    bool taken = false;
+
+    k_spinlock_key_t key = k_spin_lock(&ch->lock);
+    uint32_t tail = (uint32_t)atomic_get(&ch->tail);
+    if (tail != (uint32_t)atomic_get(&ch->head) && pred(&ch->buf[tail & ch->mask], arg)) {
+        *out = ch->buf[tail & ch->mask];
+        atomic_set(&ch->tail, (atomic_val_t)(tail + 1));
+        taken = true;
+    }
+    k_spin_unlock(&ch->lock, key);
+
+    if (taken && ch->policy == CMD_OVERFLOW_BLOCK) {
+        k_sem_give(&ch->space);
+    }
+    return taken;
+}
+
+int cmd_channel_pop(struct cmd_channel *ch, struct light_cmd *out, k_timeout_t timeout)
+{
+    while (1) {
+        if (k_sem_take(ch->items, timeout) != 0) {
+            return -EAGAIN;
+        }
+        /* the count can run ahead of the ring; just wait again */
+        if (cmd_channel_read(ch, out)) {
+            return 0;
+        }
+    }
+}
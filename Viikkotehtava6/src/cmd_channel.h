@@ -0,0 +1,107 @@
+#ifndef CMD_CHANNEL_H
+#define CMD_CHANNEL_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+/* A light command, stored by value in the channel. */
+struct light_cmd {
+    char color;
+    uint32_t duration_ms;
+    uint32_t enq_cycles;    /* k_cycle_get_32() at push, for queue-wait stats */
+    uint32_t rx_first_cycles;   /* UART commands: line arrival, see uart_io_line_times */
+    uint32_t rx_line_cycles;
+};
+
+/* What a push does when the ring is full. */
+enum cmd_overflow {
+    CMD_OVERFLOW_DROP_NEWEST,   /* refuse the new command */
+    CMD_OVERFLOW_DROP_OLDEST,   /* evict the oldest queued command */
+    CMD_OVERFLOW_BLOCK,         /* wait for space; ISR producers drop newest */
+    CMD_OVERFLOW_REJECT,        /* refuse, the caller reports an error */
+};
+
+/* Bounded ring of light_cmd values between producers (UART thread,
+ * alarm and button ISRs) and one consumer (dispatcher_task). Nothing is
+ * allocated per command.
+ *
+ * The consumer only locks for cmd_channel_read_if(). Producers take a
+ * spinlock for the few instructions of a push, because ISRs and threads
+ * can push at the same time. The tail moves by compare-and-swap, so a DROP_OLDEST producer can
+ * evict an entry while the consumer reads it; the consumer then retries.
+ * Every push gives the items semaphore so the consumer can block;
+ * several channels may share one semaphore (the dispatcher's priority
+ * lanes do), in which case the consumer takes it once and then picks a
+ * channel with cmd_channel_read(). Evictions leave the count ahead of
+ * the ring, which consumers already tolerate. */
+struct cmd_channel {
+    struct light_cmd *buf;
+    uint32_t mask;          /* capacity - 1, capacity is a power of two */
+    atomic_t head;          /* next slot to write, producers only */
+    atomic_t tail;          /* next slot to read */
+    struct k_spinlock lock;
+    struct k_sem *items;
+    struct k_sem space;     /* given on every read, BLOCK producers wait on it */
+    enum cmd_overflow policy;
+    const char *name;
+    atomic_t high_water;
+    atomic_t dropped;       /* refused: DROP_NEWEST, REJECT, BLOCK in an ISR */
+    atomic_t evicted;       /* old commands discarded (DROP_OLDEST) */
+    atomic_t blocked;       /* pushes that had to wait for space (BLOCK) */
+};
+
+#define CMD_CHANNEL_DEFINE(_name, _capacity, _items_sem, _policy)                  \
+    BUILD_ASSERT(((_capacity) & ((_capacity) - 1)) == 0 && (_capacity) > 0,       \
+                 #_name " capacity must be a power of two");                      \
+    static struct light_cmd _name##_buf[_capacity];                              \
+    static struct cmd_channel _name = {                                          \
+        .buf = _name##_buf,                                                      \
+        .mask = (_capacity) - 1,                                                 \
+        .items = (_items_sem),                                                   \
+        .space = Z_SEM_INITIALIZER(_name.space, 0, 1),                           \
+        .policy = (_policy),                                                     \
+        .name = #_name,                                                          \
+    }
+
+/* ISR-safe. Applies the channel's overflow policy when the ring is full
+ * and returns false if the command was not queued. Only a BLOCK channel
+ * pushed from a thread can wait. */
+bool cmd_channel_push(struct cmd_channel *ch, const struct light_cmd *cmd);
+
+/* Single consumer, channel with its own semaphore. Returns 0, or -EAGAIN
+ * if nothing arrived in time. */
+int cmd_channel_pop(struct cmd_channel *ch, struct light_cmd *out, k_timeout_t timeout);
+
+/* Single consumer, never blocks and leaves the semaphore alone. Returns
+ * false when the channel is empty. */
+bool cmd_channel_read(struct cmd_channel *ch, struct light_cmd *out);
+
+typedef bool (*cmd_channel_pred_t)(const struct light_cmd *cmd, void *arg);
+
+/* Like cmd_channel_read(), but takes the oldest command only if pred
+ * accepts it. The check and the pop happen under the producers' lock,
+ * so a DROP_OLDEST push cannot swap the command in between. */
+bool cmd_channel_read_if(struct cmd_channel *ch, cmd_channel_pred_t pred, void *arg,
+                         struct light_cmd *out);
+
+static inline uint32_t cmd_channel_depth(struct cmd_channel *ch)
+{
+    return (uint32_t)atomic_get(&ch->head) - (uint32_t)atomic_get(&ch->tail);
+}
+
+static inline uint32_t cmd_channel_capacity(struct cmd_channel *ch)
+{
+    return ch->mask + 1;
+}
+
+/* Clears the drop counters and restarts the high-water mark from the
+ * current depth. */
+static inline void cmd_channel_stats_reset(struct cmd_channel *ch)
+{
+    atomic_set(&ch->dropped, 0);
+    atomic_set(&ch->evicted, 0);
+    atomic_set(&ch->blocked, 0);
+    atomic_set(&ch->high_water, (atomic_val_t)cmd_channel_depth(ch));
+}
+
+#endif /* CMD_CHANNEL_H */
@@ -0,0 +1,83 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include "cmd_trace.h"
+
+#define TRACE_SIZE CONFIG_CMD_TRACE_DEPTH
+BUILD_ASSERT((TRACE_SIZE & (TRACE_SIZE - 1)) == 0, "CMD_TRACE_DEPTH must be a power of two");
+
+static struct cmd_trace ring[TRACE_SIZE];
+static uint32_t head;       /* records committed so far */
+static uint32_t first;      /* oldest record still kept */
+static struct k_spinlock lock;
+
+/* Stage pairs reported by cmd_trace_format(), in pipeline order. */
+static const struct {
+    const char *name;
+    uint8_t from;
+    uint8_t to;
+} deltas[] = {
+    { "rx",      TRACE_RX_FIRST, TRACE_RX_LINE },
+    { "parse",   TRACE_RX_LINE,  TRACE_ENQUEUE },
+    { "queue",   TRACE_ENQUEUE,  TRACE_DEQUEUE },
+    { "wake",    TRACE_DEQUEUE,  TRACE_WAKE },
+    { "on",      TRACE_WAKE,     TRACE_GPIO_ON },
+    { "hold",    TRACE_GPIO_ON,  TRACE_GPIO_OFF },
+    { "release", TRACE_GPIO_OFF, TRACE_RELEASE },
+};
+
+void cmd_trace_commit(const struct cmd_trace *tr)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    struct cmd_trace *slot = &ring[head & (TRACE_SIZE - 1)];
+    *slot = *tr;
+    slot->seq = head++;
+    if (head - first > TRACE_SIZE) first = head - TRACE_SIZE;
+    k_spin_unlock(&lock, key);
+}
+
+bool cmd_trace_next(uint32_t *pos, struct cmd_trace *out)
+{
+    bool found = false;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t seq = *pos;
+    if ((int32_t)(seq - first) < 0) seq = first;   /* overwritten meanwhile */
+    if (seq != head) {
+        *out = ring[seq & (TRACE_SIZE - 1)];
+        *pos = seq + 1;
+        found = true;
+    }
+    k_spin_unlock(&lock, key);
+    return found;
+}
+
+void cmd_trace_clear(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    first = head;
+    k_spin_unlock(&lock, key);
+}
+
+int cmd_trace_format(const struct cmd_trace *tr, const char *lane_name, char *buf, size_t cap)
+{
+    int n = snprintk(buf, cap, "#%u %c %ums %-16s", tr->seq, tr->color, tr->duration_ms, lane_name);
+    uint32_t start = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(deltas) && n >= 0 && (size_t)n < cap; i++) {
+        uint32_t a = tr->t[deltas[i].from];
+        uint32_t b = tr->t[deltas[i].to];
+
+        if (start == 0) start = a;
+        if (a != 0 && b != 0) {
+            n += snprintk(buf + n, cap - n, " %s=%u", deltas[i].name, k_cyc_to_us_floor32(b - a));
+        } else {
+            n += snprintk(buf + n, cap - n, " %s=-", deltas[i].name);
+        }
+    }
+
+    uint32_t end = tr->t[TRACE_RELEASE];
+    if (n >= 0 && (size_t)n < cap && start != 0 && end != 0) {
+        n += snprintk(buf + n, cap - n, " total=%u", k_cyc_to_us_floor32(end - start));
+    }
+    return n;
+}
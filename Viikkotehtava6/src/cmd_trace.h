@@ -0,0 +1,46 @@
+#ifndef CMD_TRACE_H
+#define CMD_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Per-command pipeline traces. Every stage a light command passes gets
+ * a k_cycle_get_32() stamp; the dispatcher commits the finished record
+ * here, and the last CONFIG_CMD_TRACE_DEPTH records are kept for the
+ * TRACE command. Commands that did not come from the UART (alarms,
+ * buttons, program steps) have no RX or enqueue stamps. */
+enum cmd_trace_stage {
+    TRACE_RX_FIRST,     /* first byte of the line reached the RX interrupt */
+    TRACE_RX_LINE,      /* its terminator did */
+    TRACE_ENQUEUE,      /* pushed into a dispatcher lane */
+    TRACE_DEQUEUE,      /* read by dispatcher_task */
+    TRACE_WAKE,         /* LED task returned from its condvar wait */
+    TRACE_GPIO_ON,
+    TRACE_GPIO_OFF,
+    TRACE_RELEASE,      /* dispatcher got release_sem back */
+    TRACE_STAGES
+};
+
+struct cmd_trace {
+    uint32_t seq;               /* set by cmd_trace_commit() */
+    char color;
+    uint8_t lane;
+    uint32_t duration_ms;
+    uint32_t t[TRACE_STAGES];   /* cycle stamps, 0 = stage not recorded */
+};
+
+/* Single writer (dispatcher_task). */
+void cmd_trace_commit(const struct cmd_trace *tr);
+
+/* Iterates the kept records oldest first: start with *pos = 0. Returns
+ * false when there are no more. */
+bool cmd_trace_next(uint32_t *pos, struct cmd_trace *out);
+
+void cmd_trace_clear(void);
+
+/* One line of per-stage deltas in microseconds ("-" where a stage is
+ * missing), without the trailing newline. */
+int cmd_trace_format(const struct cmd_trace *tr, const char *lane_name, char *buf, size_t cap);
+
+#endif /* CMD_TRACE_H */
@@ -0,0 +1,120 @@
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/printk.h>
+#include "dlog.h"
+
+#define DLOG_SIZE CONFIG_DEBUG_MSG_POOL_SIZE
+BUILD_ASSERT((DLOG_SIZE & (DLOG_SIZE - 1)) == 0, "DEBUG_MSG_POOL_SIZE must be a power of two");
+
+static struct dlog_record ring[DLOG_SIZE];
+static uint32_t head;       /* next record to write */
+static uint32_t tail;       /* next record to read  */
+static struct k_spinlock lock;
+
+K_SEM_DEFINE(dlog_ready, 0, 1);   /* given when the ring stops being empty */
+K_SEM_DEFINE(dlog_space, 0, 1);   /* given when the reader frees a record */
+
+atomic_t dlog_mask;
+
+static uint32_t high_water;
+static atomic_t dropped;
+static atomic_t evicted;
+static atomic_t lost;       /* dropped + evicted, never reset */
+
+void dlog_put(const char *fmt, uint32_t nargs, uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3)
+{
+    uint32_t stamp = k_cycle_get_32();
+
+    while (1) {
+        k_spinlock_key_t key = k_spin_lock(&lock);
+
+        if (head - tail == DLOG_SIZE) {
+            if (IS_ENABLED(CONFIG_DEBUG_MSG_OVERFLOW_DROP_OLDEST)) {
+                tail++;
+                atomic_inc(&evicted);
+                atomic_inc(&lost);
+            } else {
+                k_spin_unlock(&lock, key);
+                if (IS_ENABLED(CONFIG_DEBUG_MSG_OVERFLOW_BLOCK) && !k_is_in_isr()) {
+                    k_sem_take(&dlog_space, K_FOREVER);
+                    continue;
+                }
+                atomic_inc(&dropped);
+                atomic_inc(&lost);
+                return;
+            }
+        }
+
+        bool was_empty = (head == tail);
+        struct dlog_record *r = &ring[head & (DLOG_SIZE - 1)];
+        r->fmt = fmt;
+        r->timestamp = stamp;
+        r->nargs = (uint8_t)nargs;
+        r->args[0] = a0;
+        r->args[1] = a1;
+        r->args[2] = a2;
+        r->args[3] = a3;
+        head++;
+        if (head - tail > high_water) high_water = head - tail;
+
+        k_spin_unlock(&lock, key);
+
+        if (was_empty) k_sem_give(&dlog_ready);
+        return;
+    }
+}
+
+bool dlog_get(struct dlog_record *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    if (head == tail) {
+        k_spin_unlock(&lock, key);
+        return false;
+    }
+    *out = ring[tail & (DLOG_SIZE - 1)];
+    tail++;
+    k_spin_unlock(&lock, key);
+
+    if (IS_ENABLED(CONFIG_DEBUG_MSG_OVERFLOW_BLOCK)) k_sem_give(&dlog_space);
+    return true;
+}
+
+void dlog_wait(void)
+{
+    k_sem_take(&dlog_ready, K_FOREVER);
+}
+
+int dlog_format(const struct dlog_record *r, char *buf, size_t cap)
+{
+    /* unused trailing arguments are zero and ignored by the format */
+    return snprintk(buf, cap, r->fmt, r->args[0], r->args[1], r->args[2], r->args[3]);
+}
+
+void dlog_clear(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    tail = head;
+    k_spin_unlock(&lock, key);
+}
+
+void dlog_stats_get(struct dlog_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    out->pending = head - tail;
+    out->high_water = high_water;
+    k_spin_unlock(&lock, key);
+
+    out->capacity = DLOG_SIZE;
+    out->dropped = (uint32_t)atomic_get(&dropped);
+    out->evicted = (uint32_t)atomic_get(&evicted);
+    out->lost = (uint32_t)atomic_get(&lost);
+}
+
+void dlog_stats_reset(void)
+{
+    atomic_clear(&dropped);
+    atomic_clear(&evicted);
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    high_water = head - tail;
+    k_spin_unlock(&lock, key);
+}
@@ -0,0 +1,140 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+/* Deferred logger. A call stores the format pointer, a cycle timestamp
+ * and up to four 32-bit arguments in a preallocated ring
+ * (CONFIG_DEBUG_MSG_POOL_SIZE records); the text is only formatted later
+ * by the reader, so logging from an ISR or a timed section costs a
+ * spinlock and a 24-byte copy (40 bytes on a 64-bit target).
+ *
+ * Because formatting happens later, the format string and any %s
+ * argument must stay valid forever (string literals, static tables).
+ * Arguments are stored as uintptr_t, so pointers survive on 64-bit
+ * targets too, but integers must fit in 32 bits: cast 64-bit values
+ * down. */
+#define DLOG_ARGS_MAX 4
+
+struct dlog_record {
+    const char *fmt;
+    uint32_t timestamp;     /* k_cycle_get_32() */
+    uint8_t nargs;
+    uintptr_t args[DLOG_ARGS_MAX];
+};
+
+struct dlog_stats {
+    uint32_t capacity;
+    uint32_t pending;
+    uint32_t high_water;
+    uint32_t dropped;       /* records refused (drop newest, or BLOCK from an ISR) */
+    uint32_t evicted;       /* unread records overwritten (drop oldest) */
+    uint32_t lost;          /* dropped + evicted since boot, not cleared by dlog_stats_reset() */
+};
+
+#ifdef CONFIG_DEBUG_LOG
+void dlog_put(const char *fmt, uint32_t nargs, uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3);
+#else
+static inline void dlog_put(const char *fmt, uint32_t nargs, uintptr_t a0, uintptr_t a1,
+                            uintptr_t a2, uintptr_t a3)
+{
+}
+#endif
+
+#define DLOG_ARG(x) ((uintptr_t)(x))
+
+#define DLOG_0(fmt)                 dlog_put(fmt, 0, 0, 0, 0, 0)
+#define DLOG_1(fmt, a)              dlog_put(fmt, 1, DLOG_ARG(a), 0, 0, 0)
+#define DLOG_2(fmt, a, b)           dlog_put(fmt, 2, DLOG_ARG(a), DLOG_ARG(b), 0, 0)
+#define DLOG_3(fmt, a, b, c)        dlog_put(fmt, 3, DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), 0)
+#define DLOG_4(fmt, a, b, c, d)     dlog_put(fmt, 4, DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d))
+
+/* dlog("fmt", args...): at most DLOG_ARGS_MAX arguments. */
+#define dlog(...) UTIL_CAT(DLOG_, NUM_VA_ARGS_LESS_1(__VA_ARGS__))(__VA_ARGS__)
+
+/* ---------- Categories and levels ---------- */
+/* dlog_at(UART, WRN, "fmt", args...) logs only when CONFIG_DEBUG_LOG,
+ * CONFIG_DEBUG_LOG_UART and a CONFIG_DEBUG_LOG_LEVEL of at least WRN are
+ * all set, and the UART bit is on in the runtime mask. The first three
+ * are constants, so a site that is not built in leaves no code behind. */
+#define DLOG_LEVEL_ERR  1
+#define DLOG_LEVEL_WRN  2
+#define DLOG_LEVEL_INF  3
+#define DLOG_LEVEL_DBG  4
+
+#ifdef CONFIG_DEBUG_LOG_LEVEL
+#define DLOG_LEVEL_BUILT CONFIG_DEBUG_LOG_LEVEL
+#else
+#define DLOG_LEVEL_BUILT 0
+#endif
+
+#define DLOG_CAT_UART      BIT(0)
+#define DLOG_CAT_DISPATCH  BIT(1)
+#define DLOG_CAT_LED       BIT(2)
+#define DLOG_CAT_ALARM     BIT(3)
+#define DLOG_CAT_BUTTON    BIT(4)
+
+#define DLOG_CAT_BUILT(cat) IS_ENABLED(UTIL_CAT(CONFIG_DEBUG_LOG_, cat))
+
+/* Categories compiled in, i.e. the bits dlog_mask_set() can turn on. */
+#define DLOG_CATS_BUILT                                                  \
+    ((DLOG_CAT_BUILT(UART) ? DLOG_CAT_UART : 0) |                        \
+     (DLOG_CAT_BUILT(DISPATCH) ? DLOG_CAT_DISPATCH : 0) |                \
+     (DLOG_CAT_BUILT(LED) ? DLOG_CAT_LED : 0) |                          \
+     (DLOG_CAT_BUILT(ALARM) ? DLOG_CAT_ALARM : 0) |                      \
+     (DLOG_CAT_BUILT(BUTTON) ? DLOG_CAT_BUTTON : 0))
+
+#ifdef CONFIG_DEBUG_LOG
+extern atomic_t dlog_mask;
+
+static inline uint32_t dlog_mask_get(void)
+{
+    return (uint32_t)atomic_get(&dlog_mask);
+}
+
+/* Returns the mask actually applied: bits of categories that are not
+ * built in are cleared. */
+static inline uint32_t dlog_mask_set(uint32_t mask)
+{
+    mask &= DLOG_CATS_BUILT;
+    atomic_set(&dlog_mask, (atomic_val_t)mask);
+    return mask;
+}
+#else
+static inline uint32_t dlog_mask_get(void)
+{
+    return 0;
+}
+
+static inline uint32_t dlog_mask_set(uint32_t mask)
+{
+    return 0;
+}
+#endif
+
+#define DLOG_ON(cat, lvl)                                                \
+    (DLOG_CAT_BUILT(cat) && DLOG_LEVEL_##lvl <= DLOG_LEVEL_BUILT &&      \
+     (dlog_mask_get() & DLOG_CAT_##cat) != 0)
+
+#define dlog_at(cat, lvl, ...)                  \
+    do {                                        \
+        if (DLOG_ON(cat, lvl)) dlog(__VA_ARGS__); \
+    } while (0)
+
+/* Reader side, one thread only. dlog_get() never blocks; dlog_wait()
+ * sleeps until something was logged into an empty ring. */
+bool dlog_get(struct dlog_record *out);
+void dlog_wait(void);
+
+/* Formats a record's message (without timestamp) into buf. */
+int dlog_format(const struct dlog_record *r, char *buf, size_t cap);
+
+void dlog_clear(void);
+void dlog_stats_get(struct dlog_stats *out);
+void dlog_stats_reset(void);
+
+#endif /* DLOG_H */
@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <string.h>
+#include "latency_hist.h"
+
+#define SUB_COUNT (1u << LATENCY_HIST_SUB_BITS)
+
+BUILD_ASSERT(LATENCY_HIST_BUCKETS == 240, "bucket layout changed");
+
+static const uint16_t quantiles[LATENCY_HIST_QUANTILES] = { 5000, 9000, 9900, 9990 };  /* 1/10000 */
+
+static uint32_t bucket_of(uint32_t us)
+{
+    if (us < SUB_COUNT) return us;
+
+    uint32_t msb = 31 - (uint32_t)__builtin_clz(us);
+    uint32_t sub = (us >> (msb - LATENCY_HIST_SUB_BITS)) & (SUB_COUNT - 1);
+    return ((msb - LATENCY_HIST_SUB_BITS + 1) << LATENCY_HIST_SUB_BITS) + sub;
+}
+
+/* Largest value that lands in bucket i. */
+static uint32_t bucket_top(uint32_t i)
+{
+    if (i < SUB_COUNT) return i;
+
+    uint32_t shift = (i >> LATENCY_HIST_SUB_BITS) - 1;
+    uint32_t low = (SUB_COUNT + (i & (SUB_COUNT - 1))) << shift;
+    return low + ((1u << shift) - 1);
+}
+
+void latency_hist_record(struct latency_hist *h, uint32_t us)
+{
+    atomic_inc(&h->seq);    /* odd: update in progress */
+
+    if (atomic_cas(&h->reset_pending, 1, 0)) {
+        memset(h->buckets, 0, sizeof(h->buckets));
+        h->count = 0;
+        h->sum = 0;
+        h->min = UINT32_MAX;
+        h->max = 0;
+    }
+
+    h->buckets[bucket_of(us)]++;
+    h->count++;
+    h->sum += us;
+    if (us < h->min) h->min = us;
+    if (us > h->max) h->max = us;
+
+    atomic_inc(&h->seq);
+}
+
+static void summarize(const struct latency_hist *h, struct latency_summary *out)
+{
+    uint32_t count = h->count;
+
+    *out = (struct latency_summary){ 0 };
+    if (count == 0) return;
+
+    out->count = count;
+    out->min = h->min;
+    out->max = h->max;
+    out->mean = (uint32_t)(h->sum / count);
+
+    uint32_t seen = 0;
+    int q = 0;
+    for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS && q < LATENCY_HIST_QUANTILES; i++) {
+        seen += h->buckets[i];
+        while (q < LATENCY_HIST_QUANTILES &&
+               (uint64_t)seen * 10000 >= (uint64_t)count * quantiles[q]) {
+            uint32_t top = bucket_top(i);
+            out->pct[q++] = MIN(top, out->max);
+        }
+    }
+}
+
+int latency_hist_summary(struct latency_hist *h, struct latency_summary *out)
+{
+    *out = (struct latency_summary){ 0 };
+    for (int attempt = 0; attempt < 4; attempt++) {
+        uint32_t seq = (uint32_t)atomic_get(&h->seq);
+
+        if (atomic_get(&h->reset_pending)) {
+            *out = (struct latency_summary){ 0 };
+            return 0;
+        }
+        if (seq & 1) {
+            k_yield();      /* let a preempted writer finish */
+            continue;
+        }
+        summarize(h, out);
+        if ((uint32_t)atomic_get(&h->seq) == seq) return 0;
+    }
+    return -EBUSY;
+}
+
+void latency_hist_reset(struct latency_hist *h)
+{
+    atomic_set(&h->reset_pending, 1);
+}
@@ -0,0 +1,93 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/timing/timing.h>
+#include "dlog.h"
+
+/* Fixed-size log-linear latency histogram in microseconds. Values below
+ * 16 us get a bucket each; above that every power of two is split into 8
+ * buckets, so a percentile is reported at most 12.5% high. 240 buckets
+ * cover the whole uint32_t range in 960 bytes.
+ *
+ * Each histogram has exactly one writer, the thread that measures the
+ * probe, and it never locks: it bumps seq before and after an update, and
+ * a reader retries when seq was odd or changed under it. A reset is only
+ * requested by the reader and carried out by the writer on its next
+ * sample; until then the histogram reads as empty. */
+#define LATENCY_HIST_SUB_BITS  3
+#define LATENCY_HIST_BUCKETS   ((32 - LATENCY_HIST_SUB_BITS + 1) << LATENCY_HIST_SUB_BITS)
+
+struct latency_hist {
+    const char *name;
+    atomic_t seq;
+    atomic_t reset_pending;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+};
+
+#define LATENCY_HIST_DEFINE(_name, _label)     \
+    static struct latency_hist _name = {       \
+        .name = (_label),                      \
+        .min = UINT32_MAX,                     \
+    }
+
+/* p50, p90, p99 and p99.9 */
+#define LATENCY_HIST_QUANTILES 4
+
+struct latency_summary {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint32_t pct[LATENCY_HIST_QUANTILES];
+};
+
+/* Writer side: the probe's own thread only. */
+void latency_hist_record(struct latency_hist *h, uint32_t us);
+
+/* Any thread. Returns 0, or -EBUSY if the writer kept updating the
+ * histogram during every attempt (out then holds the last attempt). */
+int latency_hist_summary(struct latency_hist *h, struct latency_summary *out);
+
+void latency_hist_reset(struct latency_hist *h);
+
+/* ---------- Probes ---------- */
+/* A timed section that feeds a histogram (CONFIG_LATENCY_HIST) and, if
+ * the category is on, a DBG line in the debug log:
+ *
+ *   LATENCY_PROBE_BEGIN(LED, span);
+ *   ...
+ *   LATENCY_PROBE_END(span, &hist_red, "RED task runtime: %u us\n");
+ *
+ * Without CONFIG_DEBUG_LOG (which CONFIG_LATENCY_HIST depends on) both
+ * macros compile to nothing. */
+#ifdef CONFIG_LATENCY_HIST
+#define LATENCY_HIST_RECORD(h, us) latency_hist_record((h), (us))
+#else
+#define LATENCY_HIST_RECORD(h, us) ((void)(us))
+#endif
+
+#define LATENCY_PROBE_BEGIN(cat, name)                                  \
+    const bool name##_log = DLOG_ON(cat, DBG);                          \
+    const bool name##_on = IS_ENABLED(CONFIG_LATENCY_HIST) || name##_log; \
+    timing_t name = name##_on ? timing_counter_get() : 0
+
+#define LATENCY_PROBE_END(name, hist, fmt)                                      \
+    do {                                                                        \
+        if (name##_on) {                                                        \
+            timing_t name##_end = timing_counter_get();                         \
+            uint64_t name##_cyc = timing_cycles_get(&name, &name##_end);        \
+            uint32_t name##_us = (uint32_t)(timing_cycles_to_ns(name##_cyc) / 1000); \
+            LATENCY_HIST_RECORD(hist, name##_us);                               \
+            if (name##_log) dlog(fmt, name##_us);                               \
+        }                                                                       \
+    } while (0)
+
+#endif /* LATENCY_HIST_H */
@@ -4,11 +4,21 @@
 #include <zephyr/drivers/uart.h>
 #include <zephyr/sys/printk.h>
 #include <ctype.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdarg.h>
 #include <zephyr/timing/timing.h>
 #include "TimeParser.h"
+#include "CommandParser.h"
+#include "alarm_presets.h"
+#include "AlarmSchedule.h"
+#include "FrameCodec.h"
+#include "alarm_sched.h"
+#include "dlog.h"
+#include "latency_hist.h"
+#include "cmd_trace.h"
+#include "cmd_channel.h"
+#include "uart_io.h"
 
 /* ---------- Config / devices ---------- */
 #define UART_DEVICE_NODE DT_CHOSEN(zephyr_shell_uart)
@@ -46,15 +56,93 @@ static void set_yellow(bool on) { set_red(on); set_green(on); }
 
 /* ---------- Run-time flags ---------- */
 volatile bool paused = false;
-volatile bool debug_enabled = false;
 
-/* ---------- FIFO / dispatcher infra ---------- */
-struct fifo_item {
-    void *fifo_reserved;
-    char color;
-    uint32_t duration_ms;
+/* ---------- Dispatcher lanes ---------- */
+/* Commands travel by value, so producers in ISR context allocate nothing.
+ * Each kind of producer has its own lane. The dispatcher always serves
+ * the highest non-empty lane first, so a long UART backlog no longer
+ * delays an alarm or a button press. */
+enum dispatch_lane {
+    LANE_EMERGENCY,     /* "!R,2000" on UART, may cut the running LED short */
+    LANE_ALARM,         /* alarm scheduler and schedule table */
+    LANE_INTERACTIVE,   /* buttons */
+    LANE_BULK,          /* plain UART colour commands */
+    LANE_COUNT
 };
-K_FIFO_DEFINE(dispatcher_fifo);
+
+K_SEM_DEFINE(dispatch_work, 0, K_SEM_MAX_LIMIT);
+
+#if defined(CONFIG_DISPATCH_BULK_OVERFLOW_BLOCK)
+#define BULK_OVERFLOW CMD_OVERFLOW_BLOCK
+#elif defined(CONFIG_DISPATCH_BULK_OVERFLOW_DROP_OLDEST)
+#define BULK_OVERFLOW CMD_OVERFLOW_DROP_OLDEST
+#elif defined(CONFIG_DISPATCH_BULK_OVERFLOW_DROP_NEWEST)
+#define BULK_OVERFLOW CMD_OVERFLOW_DROP_NEWEST
+#else
+#define BULK_OVERFLOW CMD_OVERFLOW_REJECT
+#endif
+
+CMD_CHANNEL_DEFINE(lane_emergency, CONFIG_DISPATCH_EMERGENCY_DEPTH, &dispatch_work,
+                   CMD_OVERFLOW_DROP_OLDEST);
+CMD_CHANNEL_DEFINE(lane_alarm, CONFIG_DISPATCH_ALARM_DEPTH, &dispatch_work,
+                   CMD_OVERFLOW_DROP_NEWEST);
+CMD_CHANNEL_DEFINE(lane_interactive, CONFIG_DISPATCH_INTERACTIVE_DEPTH, &dispatch_work,
+                   CMD_OVERFLOW_DROP_NEWEST);
+CMD_CHANNEL_DEFINE(lane_bulk, CONFIG_DISPATCH_BULK_DEPTH, &dispatch_work, BULK_OVERFLOW);
+
+static struct cmd_channel *const lanes[LANE_COUNT] = {
+    &lane_emergency, &lane_alarm, &lane_interactive, &lane_bulk,
+};
+
+/* Queue-wait latency per lane. dispatcher_task adds to it and STATS
+ * reads and clears it from uart_task, hence the lock. */
+struct lane_wait {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+};
+static struct lane_wait lane_waits[LANE_COUNT];
+static struct k_spinlock lane_waits_lock;
+
+/* ---------- Latency histograms ---------- */
+/* One per timing probe, each written only by the thread it measures. */
+#ifdef CONFIG_LATENCY_HIST
+LATENCY_HIST_DEFINE(hist_uart, "uart_cmd");
+LATENCY_HIST_DEFINE(hist_sequence, "sequence");
+LATENCY_HIST_DEFINE(hist_red, "led_red");
+LATENCY_HIST_DEFINE(hist_yellow, "led_yellow");
+LATENCY_HIST_DEFINE(hist_green, "led_green");
+
+static struct latency_hist *const hists[] = {
+    &hist_uart, &hist_sequence, &hist_red, &hist_yellow, &hist_green,
+};
+#endif
+
+/* Emergency preemption. dispatch_one numbers every activation it hands
+ * to an LED task (led_gen_running, 0 while idle). An emergency push
+ * notes the activation that was running before the command became
+ * visible in its lane and gives led_abort_sem; led_hold only gives up
+ * when the abort names its own activation, so an emergency that the
+ * dispatcher picked up before the give cannot cut itself short. */
+K_SEM_DEFINE(led_abort_sem, 0, 1);
+static atomic_t led_gen_running;
+static atomic_t led_abort_gen;
+static uint32_t led_gen;        /* dispatcher_task only */
+static atomic_t led_preempted;
+
+/* Requested versus actual LED on-time, measured in cycles, updated by
+ * whichever LED task just finished (one at a time) and read by STATS. */
+struct led_timing {
+    uint32_t count;
+    uint32_t chained;       /* started on the previous deadline, not "now" */
+    int32_t err_min_us;     /* actual - requested on-time */
+    int32_t err_max_us;
+    int64_t err_sum_us;
+    uint32_t late_max_us;   /* woke up after the deadline */
+    uint64_t late_sum_us;
+};
+static struct led_timing led_timing;
+static struct k_spinlock led_timing_lock;
 
 /* ---------- Condition vars & mutexes ---------- */
 K_MUTEX_DEFINE(red_mutex);
@@ -74,95 +162,420 @@ static uint32_t green_duration = 1000;
 
 K_SEM_DEFINE(release_sem, 0, 1);
 
-/* ---------- Debug FIFO ---------- */
-struct debug_msg {
-    void *fifo_reserved;
-    char text[128];
+/* ---------- Command trace ---------- */
+/* The command in flight. dispatcher_task fills it in at dequeue, the LED
+ * task it hands the command to stamps its own stages, and the dispatcher
+ * commits it once release_sem comes back; the handoff orders the writes. */
+#ifdef CONFIG_CMD_TRACE
+static struct cmd_trace trace_cur;
+#define TRACE_STAMP(stage) (trace_cur.t[(stage)] = k_cycle_get_32())
+#else
+#define TRACE_STAMP(stage) do { } while (0)
+#endif
+
+static void trace_begin(const struct light_cmd *cmd, uint8_t lane)
+{
+#ifdef CONFIG_CMD_TRACE
+    trace_cur = (struct cmd_trace){
+        .lane = lane,
+        .t[TRACE_RX_FIRST] = cmd->rx_first_cycles,
+        .t[TRACE_RX_LINE] = cmd->rx_line_cycles,
+        .t[TRACE_ENQUEUE] = lane < LANE_COUNT ? cmd->enq_cycles : 0,   /* program steps are not queued */
+        .t[TRACE_DEQUEUE] = k_cycle_get_32(),
+    };
+#endif
+}
+
+/* ---------- Push color helper ---------- */
+/* Returns false if the lane refused the command; a REJECT lane also
+ * answers the sender with an ERR line. rx carries the UART line stamps
+ * for the command trace, NULL for other producers. */
+static bool push_color(enum dispatch_lane lane, char c, uint32_t duration_ms,
+                       const struct uart_io_line_times *rx)
+{
+    struct light_cmd cmd = {
+        .color = (char)toupper((unsigned char)c),
+        .duration_ms = duration_ms,
+        .enq_cycles = k_cycle_get_32(),
+        .rx_first_cycles = rx ? rx->first : 0,
+        .rx_line_cycles = rx ? rx->done : 0,
+    };
+
+    /* read before the push: this command cannot be running yet */
+    atomic_val_t running = atomic_get(&led_gen_running);
+
+    if (!cmd_channel_push(lanes[lane], &cmd)) {
+        if (lanes[lane]->policy == CMD_OVERFLOW_REJECT) {
+            uart_io_printf("ERR %s full\n", lanes[lane]->name);
+        }
+        dlog_at(DISPATCH, WRN, "PUSH %s: %c dropped, lane full\n", lanes[lane]->name, cmd.color);
+        return false;
+    }
+    if (lane == LANE_EMERGENCY && IS_ENABLED(CONFIG_DISPATCH_EMERGENCY_PREEMPT) && running != 0) {
+        atomic_set(&led_abort_gen, running);
+        k_sem_give(&led_abort_sem);
+    }
+    dlog_at(DISPATCH, DBG, "PUSH %s: %c, %u ms\n", lanes[lane]->name, cmd.color, cmd.duration_ms);
+    return true;
+}
+
+/* ---------- Light programs ---------- */
+/* The parser compiles a P: line into a light_program. The UART thread
+ * leaves it in a one-entry mailbox and wakes the dispatcher, which copies
+ * it out once the lanes are empty. The dispatcher then plays one step
+ * each time all lanes are idle, so queued commands still run between
+ * steps, and no step is parsed or allocated at run time. A newer program,
+ * or STOP, replaces a request that has not been picked up yet. */
+enum program_request {
+    PROGRAM_NONE,
+    PROGRAM_LOAD,
+    PROGRAM_STOP,
 };
-K_FIFO_DEFINE(debug_fifo);
 
-static void debug_log(const char *fmt, ...)
+static struct k_spinlock program_lock;
+static struct light_program program_mailbox;
+static enum program_request program_request;
+
+/* Player state, dispatcher_task only. */
+static struct light_program prog_running;
+static uint8_t prog_step;
+static uint32_t prog_pass;
+static bool prog_active;
+
+/* Copy of the player state for other threads (STATS, query frames), in
+ * one word so it is always consistent: bit 31 active, bits 24..30 step,
+ * bits 0..23 pass (saturating). */
+#define PROG_STATUS_ACTIVE      BIT(31)
+#define PROG_STATUS_STEP_SHIFT  24
+#define PROG_STATUS_PASS_MASK   0x00FFFFFFu
+static atomic_t prog_status;
+
+static void program_publish(void)
 {
-    if (!debug_enabled) return;
+    uint32_t pass = MIN(prog_pass, PROG_STATUS_PASS_MASK);
+    atomic_set(&prog_status, (atomic_val_t)((prog_active ? PROG_STATUS_ACTIVE : 0) |
+                                            ((uint32_t)prog_step << PROG_STATUS_STEP_SHIFT) | pass));
+}
 
-    struct debug_msg *m = k_malloc(sizeof(*m));
-    if (!m) return;
+static void program_post(enum program_request req, const struct light_program *prog)
+{
+    k_spinlock_key_t key = k_spin_lock(&program_lock);
+    if (prog) program_mailbox = *prog;
+    program_request = req;
+    k_spin_unlock(&program_lock, key);
 
-    va_list args;
-    va_start(args, fmt);
-    vsnprintk(m->text, sizeof(m->text), fmt, args);
-    va_end(args);
+    k_sem_give(&dispatch_work);
+}
 
-    k_fifo_put(&debug_fifo, m);
+static void program_take(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&program_lock);
+    enum program_request req = program_request;
+    if (req == PROGRAM_LOAD) prog_running = program_mailbox;
+    program_request = PROGRAM_NONE;
+    k_spin_unlock(&program_lock, key);
+
+    if (req == PROGRAM_LOAD) {
+        prog_step = 0;
+        prog_pass = 0;
+        prog_active = true;
+        dlog_at(DISPATCH, INF, "Program started: %u steps, loops=%u\n", prog_running.count, prog_running.loops);
+    } else if (req == PROGRAM_STOP && prog_active) {
+        prog_active = false;
+        dlog_at(DISPATCH, INF, "Program stopped\n");
+    }
+    program_publish();
 }
 
-/* ---------- Push color helper ---------- */
-static void push_color_to_fifo(char c, uint32_t duration_ms)
+/* Next step of the running program, or false when none is running. */
+static bool program_next(struct light_cmd *out)
 {
-    struct fifo_item *it = k_malloc(sizeof(*it));
-    if (!it) {
-        printk("push_color_to_fifo: malloc failed\n");
+    if (!prog_active) return false;
+
+    uint32_t e = prog_running.steps[prog_step];
+    *out = (struct light_cmd){
+        .color = alarm_entry_color(e),
+        .duration_ms = alarm_entry_ms(e),
+        .enq_cycles = k_cycle_get_32(),
+    };
+
+    if (++prog_step == prog_running.count) {
+        prog_step = 0;
+        if (prog_running.loops != 0 && ++prog_pass >= prog_running.loops) {
+            prog_active = false;
+            dlog_at(DISPATCH, INF, "Program finished\n");
+        }
+    }
+    program_publish();
+    return true;
+}
+
+/* ---------- Stats ---------- */
+static void dlog_stats_print(void)
+{
+#ifdef CONFIG_DEBUG_LOG
+    struct dlog_stats s;
+    dlog_stats_get(&s);
+    uart_io_printf_wait("  debug_log  depth=%u/%u high_water=%u dropped=%u evicted=%u mask=0x%02x/0x%02x\n",
+                        s.pending, s.capacity, s.high_water, s.dropped, s.evicted,
+                        dlog_mask_get(), (unsigned)DLOG_CATS_BUILT);
+#else
+    uart_io_printf_wait("  debug_log  not built in\n");
+#endif
+}
+
+static void latency_stats_print(bool reset)
+{
+#ifdef CONFIG_LATENCY_HIST
+    for (size_t i = 0; i < ARRAY_SIZE(hists); i++) {
+        struct latency_summary s;
+        latency_hist_summary(hists[i], &s);
+        uart_io_printf_wait("  %-10s n=%u min=%u mean=%u max=%u p50=%u p90=%u p99=%u p99.9=%u us\n",
+                            hists[i]->name, s.count, s.min, s.mean, s.max,
+                            s.pct[0], s.pct[1], s.pct[2], s.pct[3]);
+        if (reset) latency_hist_reset(hists[i]);
+    }
+#endif
+}
+
+static void led_timing_print(bool reset)
+{
+    k_spinlock_key_t key = k_spin_lock(&led_timing_lock);
+    struct led_timing t = led_timing;
+    if (reset) led_timing = (struct led_timing){ 0 };
+    k_spin_unlock(&led_timing_lock, key);
+
+    int32_t err_mean = t.count ? (int32_t)(t.err_sum_us / t.count) : 0;
+    uint32_t late_mean = t.count ? (uint32_t)(t.late_sum_us / t.count) : 0;
+    uart_io_printf_wait("  led_timing n=%u chained=%u err_us min=%d mean=%d max=%d late_us mean=%u max=%u\n",
+                        t.count, t.chained, t.count ? t.err_min_us : 0, err_mean,
+                        t.count ? t.err_max_us : 0, late_mean, t.late_max_us);
+}
+
+static void lane_stats_print(enum dispatch_lane lane)
+{
+    struct cmd_channel *ch = lanes[lane];
+    k_spinlock_key_t key = k_spin_lock(&lane_waits_lock);
+    struct lane_wait w = lane_waits[lane];
+    k_spin_unlock(&lane_waits_lock, key);
+
+    uart_io_printf_wait("  %-16s depth=%u/%u high_water=%u dropped=%u evicted=%u blocked=%u\n",
+                        ch->name, cmd_channel_depth(ch), cmd_channel_capacity(ch),
+                        (unsigned)atomic_get(&ch->high_water), (unsigned)atomic_get(&ch->dropped),
+                        (unsigned)atomic_get(&ch->evicted), (unsigned)atomic_get(&ch->blocked));
+    uart_io_printf_wait("  %-16s wait_avg=%u us wait_max=%u us (n=%u)\n", "",
+                        w.count ? (unsigned)(w.total_us / w.count) : 0u, w.max_us, w.count);
+}
+
+static atomic_t dispatch_coalesced;
+static atomic_t dispatch_zero_dropped;
+static atomic_t frames_ok;
+static atomic_t frames_bad;
+static atomic_t frames_seq_gaps;
+
+static void stats_print(bool reset)
+{
+    uart_io_printf_wait("STATS\n");
+    for (int i = 0; i < LANE_COUNT; i++) {
+        lane_stats_print((enum dispatch_lane)i);
+    }
+    if (IS_ENABLED(CONFIG_DISPATCH_BATCHING)) {
+        uart_io_printf_wait("  batching   coalesced=%u zero_dropped=%u\n",
+                            (unsigned)atomic_get(&dispatch_coalesced),
+                            (unsigned)atomic_get(&dispatch_zero_dropped));
+    }
+    if (IS_ENABLED(CONFIG_DISPATCH_EMERGENCY_PREEMPT)) {
+        uart_io_printf_wait("  preempted  %u\n", (unsigned)atomic_get(&led_preempted));
+    }
+    led_timing_print(reset);
+    struct uart_io_stats u;
+    uart_io_stats_get(&u);
+    uart_io_printf_wait("  uart_rx    bytes=%u lines=%u overruns=%u high_water=%u/%u\n",
+                        u.rx_bytes, u.rx_lines, u.rx_overruns, u.rx_high_water, CONFIG_UART_RX_BUF_SIZE);
+    uart_io_printf_wait("  uart_tx    bytes=%u dropped=%u high_water=%u/%u\n",
+                        u.tx_bytes, u.tx_dropped, u.tx_high_water, CONFIG_UART_TX_BUF_SIZE);
+    uart_io_printf_wait("  frames     ok=%u bad=%u seq_gaps=%u\n", (unsigned)atomic_get(&frames_ok),
+                        (unsigned)atomic_get(&frames_bad), (unsigned)atomic_get(&frames_seq_gaps));
+    uint32_t ps = (uint32_t)atomic_get(&prog_status);
+    uart_io_printf_wait("  program    %s step=%u pass=%u\n", (ps & PROG_STATUS_ACTIVE) ? "running" : "idle",
+                        (ps & ~PROG_STATUS_ACTIVE) >> PROG_STATUS_STEP_SHIFT, ps & PROG_STATUS_PASS_MASK);
+    dlog_stats_print();
+    latency_stats_print(reset);
+
+    if (reset) {
+        for (int i = 0; i < LANE_COUNT; i++) {
+            cmd_channel_stats_reset(lanes[i]);
+            k_spinlock_key_t key = k_spin_lock(&lane_waits_lock);
+            lane_waits[i] = (struct lane_wait){ 0 };
+            k_spin_unlock(&lane_waits_lock, key);
+        }
+#ifdef CONFIG_DEBUG_LOG
+        dlog_stats_reset();
+#endif
+        uart_io_stats_reset();
+        atomic_clear(&frames_ok);
+        atomic_clear(&frames_bad);
+        atomic_clear(&frames_seq_gaps);
+        atomic_clear(&dispatch_coalesced);
+        atomic_clear(&dispatch_zero_dropped);
+        atomic_clear(&led_preempted);
+        uart_io_printf_wait("  (counters reset)\n");
+    }
+}
+
+/* ---------- Alarms ---------- */
+#define ALARM_DEFAULT_DURATION_MS 1000
+
+/* Runs in timer ISR context, once per alarm that comes due. */
+static void alarm_fire(int id, char color, uint32_t duration_ms)
+{
+    dlog_at(ALARM, DBG, "Alarm #%d expired, pushing %c for %u ms\n", id, color, duration_ms);
+    push_color(LANE_ALARM, color, duration_ms, NULL);
+}
+
+/* repeat: fire every HHMMSS.mmm, count times in total (0 = forever). */
+static void alarm_arm(int seconds, uint16_t ms, char color, uint32_t duration_ms,
+                      bool repeat, uint32_t count)
+{
+    char hms[9];
+    time_format(seconds, hms, sizeof(hms), TIME_FORMAT_HH_MM_SS);
+
+    uint32_t delay_ms = (uint32_t)seconds * 1000u + ms;
+    int id = repeat ? alarm_sched_arm_periodic(delay_ms, count, color, duration_ms)
+                    : alarm_sched_arm(delay_ms, color, duration_ms);
+    if (id == -ENOMEM) {
+        uart_io_printf_wait("Alarm table full (%u pending), %s not set\n", alarm_sched_pending(), hms);
+        return;
+    } else if (id == -EINVAL) {
+        uart_io_printf_wait("Repeat period must not be zero, %s not set\n", hms);
+        return;
+    } else if (id < 0) {
+        uart_io_printf_wait("Alarm error %d, %s not set\n", id, hms);
         return;
     }
-    it->color = (char)toupper((unsigned char)c);
-    it->duration_ms = duration_ms;
-    k_fifo_put(&dispatcher_fifo, it);
-    debug_log("PUSH FIFO: %c, %u ms\n", it->color, it->duration_ms);
+
+    if (ms) uart_io_printf_wait("Alarm #%d set for %d.%03u seconds (%s) -> color %c", id, seconds, ms, hms, color);
+    else uart_io_printf_wait("Alarm #%d set for %d seconds (%s) -> color %c", id, seconds, hms, color);
+
+    if (!repeat) uart_io_printf_wait("\n");
+    else if (count == 0) uart_io_printf_wait(", repeating forever\n");
+    else uart_io_printf_wait(", %u times\n", count);
+}
+
+static void alarm_list(void)
+{
+    struct alarm_info a;
+    int64_t now = k_uptime_get();
+    int id = 0;
+
+    uart_io_printf_wait("Alarms pending: %u\n", alarm_sched_pending());
+    while (alarm_sched_next_info(id, &a)) {
+        int64_t left_ms = a.due_ms > now ? a.due_ms - now : 0;
+        char hms[9];
+        time_format((int32_t)(left_ms / 1000), hms, sizeof(hms), TIME_FORMAT_HH_MM_SS);
+        uart_io_printf_wait("  #%d in %s.%03u -> %c for %u ms", a.id, hms, (unsigned)(left_ms % 1000),
+                            a.color, a.duration_ms);
+        if (a.period_ms == 0) uart_io_printf_wait("\n");
+        else if (a.remaining == 0) uart_io_printf_wait(", every %u ms forever\n", a.period_ms);
+        else uart_io_printf_wait(", every %u ms, %u left\n", a.period_ms, a.remaining);
+        id = a.id;
+    }
 }
 
-/* ---------- Timer ---------- */
-static struct k_timer alarm_timer;
-static char alarm_color = 'R';
-static int last_timer_seconds = 0;
+/* ---------- Schedule table ---------- */
+/* A binary schedule from host/schedule_compile, read in place: one timer
+ * walks the sorted entries, so arming costs nothing per entry. */
+#ifdef ALARM_SCHEDULE_BUILTIN
+static const uint8_t builtin_schedule[] __aligned(4) = {
+#include "alarm_schedule.bin.inc"
+};
+#endif
 
-static void alarm_expiry_function(struct k_timer *timer_id)
+static struct k_timer schedule_timer;
+static const uint32_t *schedule_entries;
+static uint32_t schedule_count;
+static uint32_t schedule_next;
+static int64_t schedule_base_ms;
+
+static void schedule_arm_next(void)
 {
-    ARG_UNUSED(timer_id);
-    debug_log("Alarm timer expired, pushing %c for 1000 ms\n", alarm_color);
-    push_color_to_fifo(alarm_color, 1000);
+    if (schedule_next >= schedule_count) return;
+
+    int64_t due = schedule_base_ms + alarm_entry_ms(schedule_entries[schedule_next]);
+    k_timer_start(&schedule_timer, K_TIMEOUT_ABS_MS(due), K_NO_WAIT);
 }
 
-static void alarm_stop_function(struct k_timer *timer_id)
+static void schedule_expiry_function(struct k_timer *timer_id)
 {
     ARG_UNUSED(timer_id);
+    int64_t now = k_uptime_get();
+
+    /* entries sharing a deadline fire together */
+    do {
+        push_color(LANE_ALARM, alarm_entry_color(schedule_entries[schedule_next]),
+                   ALARM_DEFAULT_DURATION_MS, NULL);
+        schedule_next++;
+    } while (schedule_next < schedule_count &&
+             schedule_base_ms + alarm_entry_ms(schedule_entries[schedule_next]) <= now);
+
+    schedule_arm_next();
+}
+
+static int schedule_load(const void *blob, size_t size)
+{
+    const uint32_t *entries;
+    int32_t n = alarm_schedule_open(blob, size, &entries);
+    if (n < 0) return n;
+
+    k_timer_stop(&schedule_timer);
+    schedule_entries = entries;
+    schedule_count = (uint32_t)n;
+    schedule_next = 0;
+    schedule_base_ms = k_uptime_get();
+    schedule_arm_next();
+    return n;
 }
 
 /* ---------- Button handlers ---------- */
 void button_0_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
     paused = !paused;
-    printk("Button0 pressed: pause status=%d\n", (int)paused);
+    uart_io_printf("Button0 pressed: pause status=%d\n", (int)paused);
 }
 
 void button_1_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
-    if (paused) push_color_to_fifo('R', 1000);
-    else debug_log("Button1 pressed but pause active -> ignored\n");
+    if (paused) push_color(LANE_INTERACTIVE, 'R', 1000, NULL);
+    else dlog_at(BUTTON, INF, "Button1 pressed but pause active -> ignored\n");
 }
 
 void button_2_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
-    if (paused) push_color_to_fifo('Y', 1000);
-    else debug_log("Button2 pressed but pause active -> ignored\n");
+    if (paused) push_color(LANE_INTERACTIVE, 'Y', 1000, NULL);
+    else dlog_at(BUTTON, INF, "Button2 pressed but pause active -> ignored\n");
 }
 
 void button_3_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
-    if (paused) push_color_to_fifo('G', 1000);
-    else debug_log("Button3 pressed but pause active -> ignored\n");
+    if (paused) push_color(LANE_INTERACTIVE, 'G', 1000, NULL);
+    else dlog_at(BUTTON, INF, "Button3 pressed but pause active -> ignored\n");
 }
 
 void button_4_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
-    debug_enabled = !debug_enabled;
-    if (debug_enabled) printk("DEBUG MODE: ON\n");
-    else {
-        printk("DEBUG MODE: OFF\n");
-        struct debug_msg *m;
-        while ((m = k_fifo_get(&debug_fifo, K_NO_WAIT)) != NULL) {
-            k_free(m);
-        }
+#ifdef CONFIG_DEBUG_LOG
+    /* all built-in categories on, or everything off */
+    if (dlog_mask_get() == 0) {
+        dlog_mask_set(DLOG_CATS_BUILT);
+        uart_io_printf("DEBUG MODE: ON\n");
+    } else {
+        dlog_mask_set(0);
+        uart_io_printf("DEBUG MODE: OFF\n");
+        dlog_clear();
     }
+#else
+    uart_io_printf("DEBUG MODE: not built in\n");
+#endif
 }
 
 /* ---------- Button init ---------- */
@@ -176,7 +589,7 @@ static int init_buttons_and_callbacks(void)
 
     for (int i = 0; i < 5; i++) {
         if (!device_is_ready(buttons[i]->port)) {
-            printk("Button %d port not ready\n", i);
+            uart_io_printf_wait("Button %d port not ready\n", i);
             return -1;
         }
         int ret = gpio_pin_configure_dt(buttons[i], GPIO_INPUT);
@@ -185,7 +598,7 @@ static int init_buttons_and_callbacks(void)
         if (ret) return -1;
         gpio_init_callback(cbs[i], handlers[i], BIT(buttons[i]->pin));
         gpio_add_callback(buttons[i]->port, cbs[i]);
-        printk("Button %d set ok\n", i);
+        uart_io_printf_wait("Button %d set ok\n", i);
     }
     return 0;
 }
@@ -194,172 +607,614 @@ static int init_buttons_and_callbacks(void)
 #define STACKSIZE 1024
 #define PRIORITY 5
 
-void uart_task(void *p1, void *p2, void *p3)
+/* RX stamps of the line uart_task is handling, for the command trace. */
+static struct uart_io_line_times uart_rx_times;
+
+static void trace_print(bool clear)
 {
-    char buf[64];
-    int idx = 0;
-    debug_log("UART task started\n");
+#ifdef CONFIG_CMD_TRACE
+    uint32_t pos = 0;
+    struct cmd_trace tr;
+    char line[UART_IO_LINE_MAX];
+
+    uart_io_printf_wait("TRACE (stage deltas in us)\n");
+    while (cmd_trace_next(&pos, &tr)) {
+        cmd_trace_format(&tr, tr.lane < LANE_COUNT ? lanes[tr.lane]->name : "program", line, sizeof(line));
+        uart_io_printf_wait("  %s\n", line);
+    }
+    if (clear) cmd_trace_clear();
+#else
+    uart_io_printf_wait("TRACE not built in\n");
+#endif
+}
 
-    while (1) {
-        unsigned char c;
-        if (uart_poll_in(uart_dev, &c) == 0) {
+static void uart_handle_command(const struct command *cmd)
+{
+    switch (cmd->type) {
+
+    /* ------------- TIME COMMAND: HHMMSS[.mmm][/x] or HH:MM:SS[.mmm][/x] ------------- */
+    case CMD_TIME: {
+        int seconds = cmd_time_value(cmd);
+
+        /* ------ ADDED TESTROW FOR ROBOT FRAMEWORK ------ */
+        uart_io_printf_wait("%d\n", seconds);   // <----- ADDED FOR TEST
+        /* -------------------------------------------------------- */
+
+        if (cmd->time.error == 0) {
+            alarm_arm(seconds, cmd->ms, cmd->color,
+                      cmd->has_arg ? cmd->arg : ALARM_DEFAULT_DURATION_MS,
+                      cmd->repeat, cmd->repeat_count);
+        } else {
+            dlog_at(UART, WRN, "UART TIME CMD parse error: code=%d (hh=%u mm=%u ss=%u)\n",
+                      seconds, cmd->time.hh, cmd->time.mm, cmd->time.ss);
+        }
+        break;
+    }
 
-            if (c == '\r' || c == '\n') {
+    case CMD_WORD:
+        /* ---------- PRESET ALARM (A0, A1, ...) ---------- */
+        if (cmd->word_len == 1 && cmd->word[0] == 'A' && cmd->has_arg) {
+            if (cmd->arg < alarm_preset_count) {
+                alarm_arm(alarm_presets[cmd->arg].seconds, 0, alarm_presets[cmd->arg].color,
+                          ALARM_DEFAULT_DURATION_MS, false, 0);
+            } else {
+                dlog_at(UART, WRN, "UART: no alarm preset %u (have %u)\n", cmd->arg, (unsigned)alarm_preset_count);
+            }
 
-                if (idx > 0) {
-                    buf[idx] = '\0';
+        /* ---------- LIST / CANCEL,n / CANCEL ---------- */
+        } else if (strcmp(cmd->word, "LIST") == 0) {
+            alarm_list();
 
-                    char *start = buf;
-                    while (*start && isspace((unsigned char)*start)) start++;
-                    char *end = start + strlen(start) - 1;
-                    while (end >= start && isspace((unsigned char)*end)) *end-- = '\0';
+        } else if (strcmp(cmd->word, "CANCEL") == 0) {
+            if (!cmd->has_arg) {
+                alarm_sched_cancel_all();
+                uart_io_printf_wait("All alarms cancelled\n");
+            } else if (alarm_sched_cancel((int)cmd->arg) == 0) {
+                uart_io_printf_wait("Alarm #%u cancelled\n", cmd->arg);
+            } else {
+                uart_io_printf_wait("Alarm #%u not pending\n", cmd->arg);
+            }
 
-                    if (*start != '\0') {
+        /* ---------- STOP (end the running program) ---------- */
+        } else if (strcmp(cmd->word, "STOP") == 0) {
+            program_post(PROGRAM_STOP, NULL);
 
-                        size_t len = strlen(start);
-                        bool all_digits = true;
+        /* ---------- LOG / LOG,mask (debug categories) ---------- */
+        } else if (strcmp(cmd->word, "LOG") == 0) {
+            if (cmd->has_arg) dlog_mask_set(cmd->arg);
+            uart_io_printf_wait("Debug log mask=0x%02x built=0x%02x level=%d"
+                                " (UART=1 DISPATCH=2 LED=4 ALARM=8 BUTTON=16)\n",
+                                dlog_mask_get(), (unsigned)DLOG_CATS_BUILT, DLOG_LEVEL_BUILT);
 
-                        for (size_t i = 0; i < 6 && i < len; i++) {
-                            if (!isdigit((unsigned char)start[i])) { all_digits = false; break; }
-                        }
+        /* ---------- TRACE / TRACE,0 (print and clear) ---------- */
+        } else if (strcmp(cmd->word, "TRACE") == 0) {
+            trace_print(cmd->has_arg && cmd->arg == 0);
 
-                        /* ------------- TIME COMMAND: HHMMSS or HHMMSS/x ------------- */
-                        if ((len == 6 && all_digits) ||
-                            (len == 8 && start[6] == '/' && isalpha((unsigned char)start[7]))) {
+        /* ---------- STATS / STATS,0 (print and reset) ---------- */
+        } else if (strcmp(cmd->word, "STATS") == 0) {
+            stats_print(cmd->has_arg && cmd->arg == 0);
 
-                            char color = 'R';
-                            char timebuf[7] = {0};
-                            strncpy(timebuf, start, 6);
-                            if (len == 8) color = toupper((unsigned char)start[7]);
+        /* ---------- COLOR COMMAND (R,1000) ---------- */
+        } else {
+            LATENCY_PROBE_BEGIN(UART, uspan);
 
-                            int seconds = time_parse(timebuf);
+            char color = cmd->word[0];
+            uint32_t dur = cmd->has_arg ? cmd->arg : 1000;
 
-                            /* ------ ADDED TESTROW FOR ROBOT FRAMEWORK ------ */
-                            printk("%d\n", seconds);   // <----- ADDED FOR TEST
-                            /* -------------------------------------------------------- */
+            if (color == 'R' || color == 'Y' || color == 'G') {
+                push_color(cmd->urgent ? LANE_EMERGENCY : LANE_BULK, color, dur, &uart_rx_times);
+            } else {
+                dlog_at(UART, WRN, "UART: unknown color '%c' ignored\n", color);
+            }
+
+            LATENCY_PROBE_END(uspan, &hist_uart, "UART sequence handling time: %u us\n");
+        }
+        break;
 
-                            if (seconds > 0) {
-                                last_timer_seconds = seconds;
-                                alarm_color = color;
+    /* ---------- PROGRAM: P:R2000;Y500;G2000;L5 ---------- */
+    case CMD_PROGRAM:
+        program_post(PROGRAM_LOAD, &cmd->program);
+        uart_io_printf_wait("Program loaded: %u steps, loops=%u\n", cmd->program.count, cmd->program.loops);
+        break;
 
-                                printk("Alarm set for %d seconds -> color %c\n", seconds, color);
+    case CMD_TOO_LONG:
+        dlog_at(UART, WRN, "UART: input too long, line dropped\n");
+        break;
 
-                                k_timer_stop(&alarm_timer);
-                                k_timer_init(&alarm_timer, alarm_expiry_function, alarm_stop_function);
-                                k_timer_start(&alarm_timer, K_SECONDS(seconds), K_NO_WAIT);
-                            } else {
-                                debug_log("UART TIME CMD parse error: code=%d for input '%s'\n", seconds, start);
-                            }
+    default:
+        dlog_at(UART, WRN, "UART: unknown or malformed command\n");
+        break;
+    }
+}
 
-                        /* ---------- COLOR COMMAND (R,1000) ---------- */
-                        } else if (isalpha((unsigned char)start[0])) {
+/* ---------- Binary frames ---------- */
+/* Typed commands in COBS frames (FrameCodec.h), answered with a status. */
+static uint8_t frame_last_seq;
 
-                            timing_t ustart = timing_counter_get();
+/* Uploaded schedules are read in place, so they need their own buffer.
+ * One frame is one upload: FRAME_SCHEDULE_ENTRIES_MAX entries at most. */
+static uint8_t schedule_upload[FRAME_PAYLOAD_MAX] __aligned(4);
+BUILD_ASSERT(sizeof(struct alarm_schedule_header) + 4 * FRAME_SCHEDULE_ENTRIES_MAX <= sizeof(schedule_upload));
 
-                            char color = toupper((unsigned char)start[0]);
-                            uint32_t dur = 1000;
+static bool is_light(char c)
+{
+    return c == 'R' || c == 'Y' || c == 'G';
+}
 
-                            char *comma = strchr(start, ',');
-                            if (comma) dur = (uint32_t)strtoul(comma + 1, NULL, 10);
+/* u8 flags, then { u8 colour, u32 ms } per command. Reply: u8 queued. */
+static int frame_color(const struct frame *f, uint8_t *rsp, size_t *rsp_len)
+{
+    if (f->len < 6 || (f->len - 1) % 5 != 0) return FRAME_STATUS_BAD_ARG;
 
-                            if (color == 'R' || color == 'Y' || color == 'G') {
-                                push_color_to_fifo(color, dur);
-                            } else {
-                                debug_log("UART: unknown color '%c' ignored (input: '%s')\n", color, start);
-                            }
+    const uint8_t *end = f->payload + f->len;
+    for (const uint8_t *p = f->payload + 1; p < end; p += 5) {
+        if (!is_light((char)toupper(p[0]))) return FRAME_STATUS_BAD_ARG;
+    }
 
-                            timing_t uend = timing_counter_get();
-                            uint64_t ucyc = timing_cycles_get(&ustart, &uend);
-                            uint64_t usec = timing_cycles_to_ns(ucyc) / 1000;
+    enum dispatch_lane lane = (f->payload[0] & 0x01) ? LANE_EMERGENCY : LANE_BULK;
+    uint8_t queued = 0;
+    for (const uint8_t *p = f->payload + 1; p < end; p += 5) {
+        if (push_color(lane, (char)p[0], frame_get_u32(p + 1), &uart_rx_times)) queued++;
+    }
 
-                            debug_log("UART sequence handling time: %llu us\n", usec);
+    rsp[0] = queued;
+    *rsp_len = 1;
+    return (queued == (f->len - 1) / 5) ? FRAME_STATUS_OK : FRAME_STATUS_BUSY;
+}
 
-                        } else {
-                            debug_log("UART: unknown or malformed command: '%s'\n", start);
-                        }
+/* u32 delay_ms, u8 colour, u32 ms, u32 count. Reply: u32 alarm id. */
+static int frame_alarm(const struct frame *f, uint8_t *rsp, size_t *rsp_len)
+{
+    if (f->len != 13) return FRAME_STATUS_BAD_ARG;
+
+    uint32_t delay_ms = frame_get_u32(f->payload);
+    char color = (char)toupper(f->payload[4]);
+    uint32_t duration_ms = frame_get_u32(f->payload + 5);
+    uint32_t count = frame_get_u32(f->payload + 9);
+    if (delay_ms == 0 || !is_light(color)) return FRAME_STATUS_BAD_ARG;
+
+    int id;
+    if (count == 0) id = alarm_sched_arm(delay_ms, color, duration_ms);
+    else id = alarm_sched_arm_periodic(delay_ms, count == UINT32_MAX ? 0 : count, color, duration_ms);
+    if (id < 0) return FRAME_STATUS_BUSY;
+
+    frame_put_u32(rsp, (uint32_t)id);
+    *rsp_len = 4;
+    return FRAME_STATUS_OK;
+}
+
+/* u32 loops, then u32 steps. */
+static int frame_program(const struct frame *f)
+{
+    struct light_program prog;
+
+    if (f->len < 8 || f->len % 4 != 0 || (f->len - 4) / 4 > PROGRAM_STEPS_MAX) {
+        return FRAME_STATUS_BAD_ARG;
+    }
+
+    prog.loops = frame_get_u32(f->payload);
+    prog.count = (uint8_t)((f->len - 4) / 4);
+    for (uint8_t i = 0; i < prog.count; i++) {
+        prog.steps[i] = frame_get_u32(f->payload + 4 + 4 * i);
+        if (!is_light(alarm_entry_color(prog.steps[i]))) return FRAME_STATUS_BAD_ARG;
+    }
+    if (!light_program_has_time(&prog)) return FRAME_STATUS_BAD_ARG;
+
+    program_post(PROGRAM_LOAD, &prog);
+    return FRAME_STATUS_OK;
+}
+
+/* Reply: u32 uptime_ms, u16 alarms pending, u8 lane depth[LANE_COUNT],
+ * u8 flags (bit 0 program running, bit 1 paused, bit 2 debug). */
+static int frame_query(uint8_t *rsp, size_t *rsp_len)
+{
+    uint32_t pending = alarm_sched_pending();
+
+    frame_put_u32(rsp, (uint32_t)k_uptime_get());
+    rsp[4] = (uint8_t)pending;
+    rsp[5] = (uint8_t)(pending >> 8);
+    for (int i = 0; i < LANE_COUNT; i++) {
+        uint32_t d = cmd_channel_depth(lanes[i]);
+        rsp[6 + i] = d > UINT8_MAX ? UINT8_MAX : (uint8_t)d;
+    }
+    bool prog_running_now = ((uint32_t)atomic_get(&prog_status) & PROG_STATUS_ACTIVE) != 0;
+    rsp[6 + LANE_COUNT] = (prog_running_now ? 0x01 : 0) | (paused ? 0x02 : 0) | (dlog_mask_get() ? 0x04 : 0);
+    *rsp_len = 7 + LANE_COUNT;
+    return FRAME_STATUS_OK;
+}
+
+/* Replaces the running schedule. Reply: u32 entries armed, or the
+ * ALARM_SCHEDULE_ERROR_* code; the old schedule is gone either way. */
+static int frame_schedule(const struct frame *f, uint8_t *rsp, size_t *rsp_len)
+{
+    k_timer_stop(&schedule_timer);
+    schedule_count = 0;
+
+    memcpy(schedule_upload, f->payload, f->len);
+    int n = schedule_load(schedule_upload, f->len);
+
+    frame_put_u32(rsp, (uint32_t)n);
+    *rsp_len = 4;
+    return n < 0 ? FRAME_STATUS_BAD_ARG : FRAME_STATUS_OK;
+}
+
+/* buf holds the bytes between two delimiters; len may exceed the buffer,
+ * in which case the frame is answered as malformed. */
+static void frame_handle(uint8_t *buf, size_t len)
+{
+    static uint8_t wire[FRAME_WIRE_MAX];
+    uint8_t rsp[1 + 16];
+    size_t rsp_len = 0;
+    struct frame f;
+
+    int status = len <= FRAME_WIRE_MAX ? frame_decode(buf, len, &f) : FRAME_STATUS_BAD_FRAME;
+    if (len > FRAME_WIRE_MAX) memset(&f, 0, sizeof(f));
+
+    if (status == FRAME_STATUS_OK) {
+        if (atomic_get(&frames_ok) != 0 && f.seq != (uint8_t)(frame_last_seq + 1)) {
+            atomic_inc(&frames_seq_gaps);
+        }
+        frame_last_seq = f.seq;
+        atomic_inc(&frames_ok);
+
+        switch (f.type) {
+        case FRAME_COLOR:    status = frame_color(&f, &rsp[1], &rsp_len); break;
+        case FRAME_ALARM:    status = frame_alarm(&f, &rsp[1], &rsp_len); break;
+        case FRAME_PROGRAM:  status = frame_program(&f); break;
+        case FRAME_QUERY:    status = frame_query(&rsp[1], &rsp_len); break;
+        case FRAME_SCHEDULE: status = frame_schedule(&f, &rsp[1], &rsp_len); break;
+        default:             status = FRAME_STATUS_BAD_TYPE; break;
+        }
+    } else {
+        atomic_inc(&frames_bad);
+    }
+
+    rsp[0] = (uint8_t)status;
+    size_t n = frame_encode(f.seq, (uint8_t)(f.type | FRAME_REPLY), rsp, rsp_len + 1, wire, sizeof(wire));
+    uart_io_write(wire, (uint32_t)n, K_FOREVER);
+    dlog_at(UART, DBG, "FRAME seq=%u type=%u status=%d\n", f.seq, f.type, status);
+}
+
+/* Text lines and binary frames share the UART. A 0x00 byte opens a frame
+ * and the next one closes it; text never contains 0x00. */
+void uart_task(void *p1, void *p2, void *p3)
+{
+    static struct cmd_parser parser;
+    static uint8_t frame_rx[FRAME_WIRE_MAX];
+    size_t frame_len = 0;
+    bool in_frame = false;
+    struct command cmd;
+
+    cmd_parser_init(&parser);
+    dlog_at(UART, INF, "UART task started\n");
+
+    while (1) {
+        uart_io_wait_line(K_FOREVER);
+
+        uint8_t chunk[32];
+        uint32_t n;
+        while ((n = uart_io_read(chunk, sizeof(chunk))) > 0) {
+            for (uint32_t i = 0; i < n; i++) {
+                uint8_t b = chunk[i];
+
+                if (IS_ENABLED(CONFIG_CMD_TRACE)) uart_io_line_track(b, &uart_rx_times);
+
+                if (b == 0x00) {
+                    if (in_frame && frame_len > 0) {
+                        frame_handle(frame_rx, frame_len);
+                        in_frame = false;
+                    } else {
+                        in_frame = true;
+                        cmd_parser_init(&parser);   /* drop any partial text line */
                     }
+                    frame_len = 0;
+                } else if (in_frame) {
+                    if (frame_len < sizeof(frame_rx)) frame_rx[frame_len] = b;
+                    frame_len++;
+                } else if (cmd_parser_feed(&parser, (char)b, &cmd)) {
+                    uart_handle_command(&cmd);
                 }
-                idx = 0;
-
-            } else {
-                if (idx < (int)sizeof(buf) - 1) buf[idx++] = (char)c;
-                else { debug_log("UART: input too long, dropping buffer\n"); idx = 0; }
             }
         }
-
-        k_msleep(10);
     }
 }
 
 /* ---------- Dispatcher ---------- */
+static uint32_t add_sat(uint32_t a, uint32_t b)
+{
+    return (a > UINT32_MAX - b) ? UINT32_MAX : a + b;
+}
+
+static void lane_wait_record(enum dispatch_lane lane, const struct light_cmd *cmd)
+{
+    uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - cmd->enq_cycles);
+
+    k_spinlock_key_t key = k_spin_lock(&lane_waits_lock);
+    struct lane_wait *w = &lane_waits[lane];
+    w->count++;
+    w->total_us += us;
+    if (us > w->max_us) w->max_us = us;
+    k_spin_unlock(&lane_waits_lock, key);
+}
+
+/* Strict priority: the first non-empty lane wins. */
+static bool dispatch_next(struct light_cmd *out, enum dispatch_lane *lane)
+{
+    for (int i = 0; i < LANE_COUNT; i++) {
+        if (cmd_channel_read(lanes[i], out)) {
+            *lane = (enum dispatch_lane)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Merges the commands queued directly behind cmd in the same lane while
+ * they have the same colour, and drops zero durations along the way. A
+ * burst of R,100 lines then costs one LED handoff. A different colour
+ * stays queued, so the higher lanes are checked again before the next
+ * activation. */
+static bool coalesces_with(const struct light_cmd *next, void *arg)
+{
+    const struct light_cmd *cmd = arg;
+    return next->color == cmd->color || next->duration_ms == 0;
+}
+
+static void dispatch_coalesce(enum dispatch_lane lane, struct light_cmd *cmd)
+{
+    struct light_cmd next;
+
+    while (cmd_channel_read_if(lanes[lane], coalesces_with, cmd, &next)) {
+        k_sem_take(&dispatch_work, K_NO_WAIT);
+        lane_wait_record(lane, &next);
+
+        if (next.duration_ms == 0) {
+            atomic_inc(&dispatch_zero_dropped);
+        } else {
+            cmd->duration_ms = add_sat(cmd->duration_ms, next.duration_ms);
+            atomic_inc(&dispatch_coalesced);
+        }
+    }
+}
+
+/* Hands one command to its LED task and waits until it has finished. */
+static void dispatch_one(const struct light_cmd *cmd)
+{
+    LATENCY_PROBE_BEGIN(DISPATCH, seq);
+    dlog_at(DISPATCH, DBG, "Dispatcher got: %c, %u ms\n", cmd->color, cmd->duration_ms);
+
+#ifdef CONFIG_CMD_TRACE
+    /* after coalescing, so the trace shows what actually ran */
+    trace_cur.color = cmd->color;
+    trace_cur.duration_ms = cmd->duration_ms;
+#endif
+
+    if (++led_gen == 0) led_gen = 1;
+    atomic_set(&led_gen_running, (atomic_val_t)led_gen);
+
+    switch (cmd->color) {
+        case 'R':
+            k_mutex_lock(&red_mutex, K_FOREVER);
+            red_pending = true; red_duration = cmd->duration_ms;
+            k_condvar_signal(&red_cond);
+            k_mutex_unlock(&red_mutex);
+            break;
+
+        case 'Y':
+            k_mutex_lock(&yellow_mutex, K_FOREVER);
+            yellow_pending = true; yellow_duration = cmd->duration_ms;
+            k_condvar_signal(&yellow_cond);
+            k_mutex_unlock(&yellow_mutex);
+            break;
+
+        case 'G':
+            k_mutex_lock(&green_mutex, K_FOREVER);
+            green_pending = true; green_duration = cmd->duration_ms;
+            k_condvar_signal(&green_cond);
+            k_mutex_unlock(&green_mutex);
+            break;
+
+        default:
+            /* no LED task will release us for an unknown colour */
+            dlog_at(DISPATCH, WRN, "Dispatcher: unknown color '%c' dropped\n", cmd->color);
+            atomic_set(&led_gen_running, 0);
+            return;
+    }
+
+    k_sem_take(&release_sem, K_FOREVER);
+    atomic_set(&led_gen_running, 0);
+    TRACE_STAMP(TRACE_RELEASE);
+#ifdef CONFIG_CMD_TRACE
+    cmd_trace_commit(&trace_cur);
+#endif
+
+    LATENCY_PROBE_END(seq, &hist_sequence, "Full sequence runtime: %u us\n");
+}
+
 void dispatcher_task(void *p1, void *p2, void *p3)
 {
-    debug_log("Dispatcher task started\n");
+    dlog_at(DISPATCH, INF, "Dispatcher task started\n");
 
     while (1) {
-        struct fifo_item *it = k_fifo_get(&dispatcher_fifo, K_FOREVER);
-        if (!it) continue;
-
-        timing_t seq_start = timing_counter_get();
-        debug_log("Dispatcher got: %c, %u ms\n", it->color, it->duration_ms);
-
-        switch (it->color) {
-            case 'R':
-                k_mutex_lock(&red_mutex, K_FOREVER);
-                red_pending = true; red_duration = it->duration_ms;
-                k_condvar_signal(&red_cond);
-                k_mutex_unlock(&red_mutex);
-                break;
-
-            case 'Y':
-                k_mutex_lock(&yellow_mutex, K_FOREVER);
-                yellow_pending = true; yellow_duration = it->duration_ms;
-                k_condvar_signal(&yellow_cond);
-                k_mutex_unlock(&yellow_mutex);
-                break;
-
-            case 'G':
-                k_mutex_lock(&green_mutex, K_FOREVER);
-                green_pending = true; green_duration = it->duration_ms;
-                k_condvar_signal(&green_cond);
-                k_mutex_unlock(&green_mutex);
-                break;
-        }
+        /* queued commands first; a running program only fills idle time */
+        bool queued = k_sem_take(&dispatch_work, prog_active ? K_NO_WAIT : K_FOREVER) == 0;
 
-        k_sem_take(&release_sem, K_FOREVER);
+        /* drop an abort left over from an activation that has ended;
+         * led_hold() would ignore it, but only after waking up for it */
+        k_sem_reset(&led_abort_sem);
 
-        timing_t seq_end = timing_counter_get();
-        uint64_t seq_usec =
-            timing_cycles_to_ns(timing_cycles_get(&seq_start, &seq_end)) / 1000;
+        struct light_cmd cmd;
+        enum dispatch_lane lane;
 
-        debug_log("Full sequence runtime: %llu us\n", seq_usec);
+        if (!queued) {
+            if (program_next(&cmd)) {
+                trace_begin(&cmd, LANE_COUNT);
+                dispatch_one(&cmd);
+            }
+            continue;
+        }
+        if (!dispatch_next(&cmd, &lane)) {
+            /* the count was for the program mailbox, or ran ahead of the rings */
+            program_take();
+            continue;
+        }
+
+        trace_begin(&cmd, lane);
+        lane_wait_record(lane, &cmd);
+
+        if (IS_ENABLED(CONFIG_DISPATCH_BATCHING)) {
+            if (cmd.duration_ms == 0) {
+                atomic_inc(&dispatch_zero_dropped);
+                continue;
+            }
+            dispatch_coalesce(lane, &cmd);
+        }
 
-        k_free(it);
+        dispatch_one(&cmd);
     }
 }
 
 /* ---------- LED tasks ---------- */
+/* Every activation ends on an absolute deadline rather than after a
+ * relative sleep. A command that starts within CONFIG_LED_CHAIN_US of
+ * the previous deadline is scheduled from that deadline, so the handoff
+ * between commands is absorbed instead of adding up over a sequence.
+ * With CONFIG_LED_TIMING_CYCLES deadlines are in cycles and the last
+ * CONFIG_LED_TIMING_SPIN_US are busy-waited for sub-tick accuracy. */
+#ifdef CONFIG_LED_TIMING_CYCLES
+#define led_clock()             k_cycle_get_64()
+#define led_clock_from_ms(ms)   k_ms_to_cyc_ceil64(ms)
+#define led_clock_from_us(us)   k_us_to_cyc_ceil64(us)
+#define led_clock_to_us(t)      k_cyc_to_us_floor64(t)
+#else
+#define led_clock()             ((uint64_t)k_uptime_ticks())
+#define led_clock_from_ms(ms)   k_ms_to_ticks_ceil64(ms)
+#define led_clock_from_us(us)   k_us_to_ticks_ceil64(us)
+#define led_clock_to_us(t)      k_ticks_to_us_floor64(t)
+#endif
+
+static uint64_t led_deadline;   /* end of the last full activation, 0 = none */
+
+/* The on-time is measured with the cycle counter, not led_clock(): with
+ * LED_TIMING_TICKS a tick clock cannot see the part of a tick that was
+ * already gone when the LED came on. */
+#ifdef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+typedef uint64_t led_stamp_t;
+#define led_stamp()             k_cycle_get_64()
+#else
+typedef uint32_t led_stamp_t;
+#define led_stamp()             k_cycle_get_32()
+#endif
+
+/* Microseconds between two led_stamp()s. A 32-bit count wraps within
+ * minutes, so it is unwrapped around the same interval in led_clock()
+ * units (coarse), which is off by a tick at most. */
+static uint64_t led_stamp_us(led_stamp_t from, led_stamp_t to, uint64_t coarse)
+{
+#ifdef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+    ARG_UNUSED(coarse);
+    return k_cyc_to_us_floor64(to - from);
+#else
+    uint64_t approx = k_us_to_cyc_floor64(led_clock_to_us(coarse));
+    int32_t fix = (int32_t)((uint32_t)(to - from) - (uint32_t)approx);
+    return k_cyc_to_us_floor64((uint64_t)((int64_t)approx + fix));
+#endif
+}
+
+/* Returns true if an emergency command cut the wait short. */
+static bool led_sleep(k_timeout_t timeout)
+{
+    if (!IS_ENABLED(CONFIG_DISPATCH_EMERGENCY_PREEMPT)) {
+        k_sleep(timeout);
+        return false;
+    }
+    return k_sem_take(&led_abort_sem, timeout) == 0;
+}
+
+static bool led_wait_until(uint64_t deadline)
+{
+#ifdef CONFIG_LED_TIMING_CYCLES
+    uint64_t spin = led_clock_from_us(CONFIG_LED_TIMING_SPIN_US);
+    uint64_t now = led_clock();
+
+    if (deadline > now + spin) {
+        if (led_sleep(K_USEC(led_clock_to_us(deadline - spin - now)))) return true;
+    }
+    while (led_clock() < deadline) {
+        /* at most CONFIG_LED_TIMING_SPIN_US plus the wakeup latency */
+    }
+    return false;
+#else
+    return led_sleep(K_TIMEOUT_ABS_TICKS(deadline));
+#endif
+}
+
+static void led_timing_record(uint32_t dur, uint64_t on_us, uint64_t late, bool chained)
+{
+    int64_t err64 = (int64_t)on_us - (int64_t)dur * 1000;
+    int32_t err = (int32_t)CLAMP(err64, INT32_MIN, INT32_MAX);
+    uint32_t late_us = (uint32_t)MIN(led_clock_to_us(late), UINT32_MAX);
+
+    k_spinlock_key_t key = k_spin_lock(&led_timing_lock);
+    struct led_timing *t = &led_timing;
+    if (t->count == 0 || err < t->err_min_us) t->err_min_us = err;
+    if (t->count == 0 || err > t->err_max_us) t->err_max_us = err;
+    t->count++;
+    t->chained += chained;
+    t->err_sum_us += err;
+    t->late_sum_us += late_us;
+    if (late_us > t->late_max_us) t->late_max_us = late_us;
+    k_spin_unlock(&led_timing_lock, key);
+}
+
+/* Keeps an LED on for dur ms, or less if an emergency command arrives.
+ * Called right after the LED was switched on. */
+static void led_hold(uint32_t dur)
+{
+    led_stamp_t on = led_stamp();
+    uint64_t now = led_clock();
+    bool chained = led_deadline != 0 && now >= led_deadline &&
+                   now - led_deadline <= led_clock_from_us(CONFIG_LED_CHAIN_US);
+    uint64_t deadline = (chained ? led_deadline : now) + led_clock_from_ms(dur);
+    atomic_val_t gen = atomic_get(&led_gen_running);
+
+    while (led_wait_until(deadline)) {
+        if (atomic_get(&led_abort_gen) != gen) {
+            continue;   /* raised for an activation that already ended */
+        }
+        led_deadline = 0;   /* the next command starts a new timeline */
+        atomic_inc(&led_preempted);
+        dlog_at(LED, INF, "LED activation cut short by emergency command\n");
+        return;
+    }
+
+    led_stamp_t off = led_stamp();
+    uint64_t end = led_clock();
+    uint64_t late = end > deadline ? end - deadline : 0;
+    led_deadline = deadline;
+    led_timing_record(dur, led_stamp_us(on, off, end - now), late, chained);
+}
+
 void red_task(void *p1, void *p2, void *p3)
 {
     while (1) {
         k_mutex_lock(&red_mutex, K_FOREVER);
         while (!red_pending) k_condvar_wait(&red_cond, &red_mutex, K_FOREVER);
         red_pending = false;
+        TRACE_STAMP(TRACE_WAKE);
 
         uint32_t dur = red_duration;
         k_mutex_unlock(&red_mutex);
 
-        timing_t start = timing_counter_get();
+        LATENCY_PROBE_BEGIN(LED, span);
 
         set_red(true);
-        k_msleep(dur);
+        TRACE_STAMP(TRACE_GPIO_ON);
+        led_hold(dur);
         set_red(false);
+        TRACE_STAMP(TRACE_GPIO_OFF);
 
-        timing_t end = timing_counter_get();
-        uint64_t usec =
-            timing_cycles_to_ns(timing_cycles_get(&start, &end)) / 1000;
-
-        debug_log("RED task runtime: %llu us\n", usec);
+        LATENCY_PROBE_END(span, &hist_red, "RED task runtime: %u us\n");
 
         k_sem_give(&release_sem);
     }
@@ -368,24 +1223,23 @@ void red_task(void *p1, void *p2, void *p3)
 void yellow_task(void *p1, void *p2, void *p3)
 {
     while (1) {
-        k_mutex_lock(&yellow_mutex, K_FOREEVER);
+        k_mutex_lock(&yellow_mutex, K_FOREVER);
         while (!yellow_pending) k_condvar_wait(&yellow_cond, &yellow_mutex, K_FOREVER);
         yellow_pending = false;
+        TRACE_STAMP(TRACE_WAKE);
 
         uint32_t dur = yellow_duration;
         k_mutex_unlock(&yellow_mutex);
 
-        timing_t start = timing_counter_get();
+        LATENCY_PROBE_BEGIN(LED, span);
 
         set_yellow(true);
-        k_msleep(dur);
+        TRACE_STAMP(TRACE_GPIO_ON);
+        led_hold(dur);
         set_yellow(false);
+        TRACE_STAMP(TRACE_GPIO_OFF);
 
-        timing_t end = timing_counter_get();
-        uint64_t usec =
-            timing_cycles_to_ns(timing_cycles_get(&start, &end)) / 1000;
-
-        debug_log("YELLOW task runtime: %llu us\n", usec);
+        LATENCY_PROBE_END(span, &hist_yellow, "YELLOW task runtime: %u us\n");
 
         k_sem_give(&release_sem);
     }
@@ -397,39 +1251,51 @@ void green_task(void *p1, void *p2, void *p3)
         k_mutex_lock(&green_mutex, K_FOREVER);
         while (!green_pending) k_condvar_wait(&green_cond, &green_mutex, K_FOREVER);
         green_pending = false;
+        TRACE_STAMP(TRACE_WAKE);
 
         uint32_t dur = green_duration;
         k_mutex_unlock(&green_mutex);
 
-        timing_t start = timing_counter_get();
+        LATENCY_PROBE_BEGIN(LED, span);
 
         set_green(true);
-        k_msleep(dur);
+        TRACE_STAMP(TRACE_GPIO_ON);
+        led_hold(dur);
         set_green(false);
+        TRACE_STAMP(TRACE_GPIO_OFF);
 
-        timing_t end = timing_counter_get();
-        uint64_t usec =
-            timing_cycles_to_ns(timing_cycles_get(&start, &end)) / 1000;
-
-        debug_log("GREEN task runtime: %llu us\n", usec);
+        LATENCY_PROBE_END(span, &hist_green, "GREEN task runtime: %u us\n");
 
         k_sem_give(&release_sem);
     }
 }
 
 /* ---------- Debug task ---------- */
+#ifdef CONFIG_DEBUG_LOG
 void debug_task(void *p1, void *p2, void *p3)
 {
-    printk("Debug task started (prints only when DEBUG MODE ON and messages queued)\n");
+    uint32_t lost_seen = 0;
+    uart_io_printf_wait("Debug task started (prints only when DEBUG MODE ON and messages queued)\n");
 
     while (1) {
-        struct debug_msg *m = k_fifo_get(&debug_fifo, K_FOREVER);
-        if (m) {
-            printk("%s", m->text);
-            k_free(m);
+        struct dlog_record r;
+        char text[UART_IO_LINE_MAX];
+
+        dlog_wait();
+        while (dlog_get(&r)) {
+            dlog_format(&r, text, sizeof(text));
+            uart_io_printf_wait("[%10u] %s", k_cyc_to_us_floor32(r.timestamp), text);
+        }
+
+        struct dlog_stats s;
+        dlog_stats_get(&s);
+        if (s.lost != lost_seen) {
+            uart_io_printf_wait("(%u debug messages dropped, log full)\n", s.lost - lost_seen);
+            lost_seen = s.lost;
         }
     }
 }
+#endif
 
 /* ---------- Threads ---------- */
 K_THREAD_DEFINE(uart_tid, STACKSIZE, uart_task, NULL, NULL, NULL, PRIORITY, 0, 0);
@@ -437,29 +1303,54 @@ K_THREAD_DEFINE(dispatcher_tid, STACKSIZE, dispatcher_task, NULL, NULL, NULL, PR
 K_THREAD_DEFINE(red_tid, STACKSIZE, red_task, NULL, NULL, NULL, PRIORITY, 0, 0);
 K_THREAD_DEFINE(yellow_tid, STACKSIZE, yellow_task, NULL, NULL, NULL, PRIORITY, 0, 0);
 K_THREAD_DEFINE(green_tid, STACKSIZE, green_task, NULL, NULL, NULL, PRIORITY, 0, 0);
+#ifdef CONFIG_DEBUG_LOG
 K_THREAD_DEFINE(debug_tid, STACKSIZE, debug_task, NULL, NULL, NULL, PRIORITY, 0, 0);
+#endif
 
 /* ---------- Main ---------- */
 int main(void)
 {
-    timing_init();
-    timing_start();
+    if (IS_ENABLED(CONFIG_DEBUG_LOG)) {
+        timing_init();
+        timing_start();
+    }
 
-    k_timer_init(&alarm_timer, alarm_expiry_function, alarm_stop_function);
+    alarm_sched_init(alarm_fire);
+    k_timer_init(&schedule_timer, schedule_expiry_function, NULL);
 
     printk("Traffic light system starting\n");
 
     if (!device_is_ready(uart_dev)) return -1;
+    if (uart_io_init(uart_dev) != 0) return -1;
     if (!device_is_ready(red.port) || !device_is_ready(green.port)) return -1;
 
     gpio_pin_configure_dt(&red, GPIO_OUTPUT_INACTIVE);
     gpio_pin_configure_dt(&green, GPIO_OUTPUT_INACTIVE);
 
-    if (init_buttons_and_callbacks() != 0) return -1;
+    if (init_buttons_and_callbacks() != 0) {
+        uart_io_flush(K_MSEC(100));
+        return -1;
+    }
 
-    printk("System online. Use serial commands like: R,2000\\r Y,1000\\r G,1500\\r\n");
-    printk("Send HHMMSS or HHMMSS/x (e.g. 000005/r/y/g) to set an alarm that triggers selected color\n");
-    printk("Toggle debug output with BUTTON4 (DEBUG MODE ON/OFF)\n");
+    uart_io_printf_wait("System online. Use serial commands like: R,2000\\r Y,1000\\r G,1500\\r\n");
+    uart_io_printf_wait("Send HHMMSS or HHMMSS/x (e.g. 000005/r/y/g) to set an alarm that triggers selected color\n");
+    uart_io_printf_wait("HH:MM:SS and a .mmm millisecond suffix are accepted too (e.g. 00:00:05.250/g)\n");
+    uart_io_printf_wait("Append ,ms after the color for the on-time (e.g. 000005/g,2500)\n");
+    uart_io_printf_wait("Append *N to repeat every HHMMSS N times, * alone repeats forever (e.g. 000030/y*10)\n");
+    uart_io_printf_wait("Send A0..A%u to arm a built-in alarm preset\n", (unsigned)alarm_preset_count - 1);
+    uart_io_printf_wait("LIST shows pending alarms, CANCEL,n cancels one, CANCEL cancels all\n");
+    uart_io_printf_wait("Prefix a color command with ! for the emergency lane (e.g. !R,3000)\n");
+    uart_io_printf_wait("P:R2000;Y500;G2000;L5 plays a light program 5 times (L0 = forever), STOP ends it\n");
+    uart_io_printf_wait("STATS prints queue, pool and latency counters, STATS,0 also resets them\n");
+    uart_io_printf_wait("TRACE shows where recent commands spent their time, TRACE,0 also clears it\n");
+    uart_io_printf_wait("Binary COBS frames (0x00 ... 0x00, see FrameCodec.h) are accepted too\n");
+#ifdef ALARM_SCHEDULE_BUILTIN
+    int n = schedule_load(builtin_schedule, sizeof(builtin_schedule));
+    if (n >= 0) uart_io_printf_wait("Built-in schedule: %d alarms armed\n", n);
+    else uart_io_printf_wait("Built-in schedule rejected: code=%d\n", n);
+#endif
+
+    uart_io_printf_wait("Toggle debug output with BUTTON4 (DEBUG MODE ON/OFF), LOG,mask picks categories\n");
 
     while (1) {
         k_sleep(K_SECONDS(60));
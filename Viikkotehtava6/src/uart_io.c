@@ -0,0 +1,330 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/printk.h>
+#include "uart_io.h"
+
+static const struct device *io_dev;
+
+RING_BUF_DECLARE(rx_ring, CONFIG_UART_RX_BUF_SIZE);
+static struct k_spinlock rx_lock;
+K_SEM_DEFINE(rx_line_sem, 0, 1);
+
+static atomic_t rx_bytes;
+static atomic_t rx_lines;
+static atomic_t rx_overruns;
+static atomic_t rx_high_water;
+
+RING_BUF_DECLARE(tx_ring, CONFIG_UART_TX_BUF_SIZE);
+static struct k_spinlock tx_lock;
+K_SEM_DEFINE(tx_space_sem, 0, 1);   /* given when the ISR frees room */
+K_SEM_DEFINE(tx_idle_sem, 0, 1);    /* given when the ISR empties the ring */
+
+static atomic_t tx_bytes;
+static atomic_t tx_dropped;
+static atomic_t tx_high_water;
+
+/* Splits the byte stream into text lines and 0x00 frames the way
+ * uart_task does: 0x00 opens a frame, or closes one that has data, and
+ * inside a frame '\n' and '\r' are data like any other byte. */
+struct rx_framing {
+    bool in_frame;
+    bool open;          /* a line or frame has data */
+};
+
+enum rx_event {
+    RX_NONE,
+    RX_START,           /* first byte of a line or frame */
+    RX_END,             /* the byte that ends a non-empty line or frame */
+};
+
+static enum rx_event rx_framing_feed(struct rx_framing *f, uint8_t b)
+{
+    if (b == 0x00) {
+        bool end = f->in_frame && f->open;
+
+        f->in_frame = !end;     /* a partial text line is dropped */
+        f->open = false;
+        return end ? RX_END : RX_NONE;
+    }
+    if (!f->in_frame && (b == '\n' || b == '\r')) {
+        bool end = f->open;
+
+        f->open = false;
+        return end ? RX_END : RX_NONE;
+    }
+    if (f->open) return RX_NONE;
+    f->open = true;
+    return RX_START;
+}
+
+/* The interrupt's view of the stream, for the bytes that made it into the
+ * ring. Under rx_lock. */
+static struct rx_framing isr_framing;
+
+/* Line arrival stamps for command traces (CONFIG_CMD_TRACE). The RX
+ * interrupt numbers the lines and frames it sees and stamps their first
+ * and last byte; the reader numbers the same bytes again in
+ * uart_io_line_track(), so the two sides meet on the line number. Under
+ * rx_lock. */
+#define LINE_STAMPS 8
+static struct uart_io_line_times line_stamps[LINE_STAMPS];
+static uint32_t line_isr_seq;
+static uint32_t line_rd_seq;
+static struct rx_framing rd_framing;
+
+/* Called with rx_lock held for the bytes about to enter the ring.
+ * Returns how many lines and frames they complete. */
+static uint32_t rx_scan(const uint8_t *p, uint32_t n)
+{
+    uint32_t now = IS_ENABLED(CONFIG_CMD_TRACE) ? k_cycle_get_32() : 0;
+    uint32_t ends = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        switch (rx_framing_feed(&isr_framing, p[i])) {
+        case RX_START:
+            if (IS_ENABLED(CONFIG_CMD_TRACE)) {
+                line_isr_seq++;
+                line_stamps[line_isr_seq % LINE_STAMPS] = (struct uart_io_line_times){ .first = now };
+            }
+            break;
+        case RX_END:
+            ends++;
+            if (IS_ENABLED(CONFIG_CMD_TRACE)) line_stamps[line_isr_seq % LINE_STAMPS].done = now;
+            break;
+        default:
+            break;
+        }
+    }
+    return ends;
+}
+
+static void rx_drain_fifo(const struct device *dev)
+{
+    uint8_t chunk[16];
+    bool wake = false;
+    int n;
+
+    while ((n = uart_fifo_read(dev, chunk, sizeof(chunk))) > 0) {
+        k_spinlock_key_t key = k_spin_lock(&rx_lock);
+        uint32_t ends = rx_scan(chunk, MIN((uint32_t)n, ring_buf_space_get(&rx_ring)));
+        uint32_t put = ring_buf_put(&rx_ring, chunk, (uint32_t)n);
+        uint32_t used = ring_buf_size_get(&rx_ring);
+        k_spin_unlock(&rx_lock, key);
+
+        if (ends > 0) {
+            wake = true;
+            atomic_add(&rx_lines, (atomic_val_t)ends);
+        }
+        atomic_add(&rx_bytes, (atomic_val_t)put);
+        if (put < (uint32_t)n) {
+            atomic_add(&rx_overruns, (atomic_val_t)(n - put));
+        }
+        if ((atomic_val_t)used > atomic_get(&rx_high_water)) {
+            atomic_set(&rx_high_water, (atomic_val_t)used);
+        }
+        /* a run of bytes without a terminator must not fill the ring */
+        if (used >= CONFIG_UART_RX_BUF_SIZE / 2) {
+            wake = true;
+        }
+    }
+
+    if (wake) {
+        k_sem_give(&rx_line_sem);
+    }
+}
+
+static void tx_fill_fifo(const struct device *dev)
+{
+    uint8_t *data;
+
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+    uint32_t n = ring_buf_get_claim(&tx_ring, &data, CONFIG_UART_TX_BUF_SIZE);
+    int sent = (n > 0) ? uart_fifo_fill(dev, data, (int)n) : 0;
+    ring_buf_get_finish(&tx_ring, sent > 0 ? (uint32_t)sent : 0);
+
+    /* disabled under the lock, so a writer's enable cannot be lost */
+    bool empty = ring_buf_is_empty(&tx_ring);
+    if (empty) {
+        uart_irq_tx_disable(dev);
+    }
+    k_spin_unlock(&tx_lock, key);
+
+    if (sent > 0) {
+        k_sem_give(&tx_space_sem);
+    }
+    if (empty) {
+        k_sem_give(&tx_idle_sem);
+    }
+}
+
+static void uart_io_isr(const struct device *dev, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    while (uart_irq_update(dev) && uart_irq_is_pending(dev)) {
+        if (uart_irq_rx_ready(dev)) {
+            rx_drain_fifo(dev);
+        }
+        if (uart_irq_tx_ready(dev)) {
+            tx_fill_fifo(dev);
+        }
+    }
+}
+
+int uart_io_init(const struct device *dev)
+{
+    io_dev = dev;
+
+    int err = uart_irq_callback_user_data_set(dev, uart_io_isr, NULL);
+    if (err != 0) {
+        return err;
+    }
+
+    uart_irq_rx_enable(dev);
+    return 0;
+}
+
+int uart_io_wait_line(k_timeout_t timeout)
+{
+    return k_sem_take(&rx_line_sem, timeout) == 0 ? 0 : -EAGAIN;
+}
+
+uint32_t uart_io_read(uint8_t *buf, uint32_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&rx_lock);
+    uint32_t n = ring_buf_get(&rx_ring, buf, len);
+    k_spin_unlock(&rx_lock, key);
+    return n;
+}
+
+bool uart_io_line_track(uint8_t b, struct uart_io_line_times *out)
+{
+    switch (rx_framing_feed(&rd_framing, b)) {
+    case RX_START:
+        line_rd_seq++;
+        return false;
+    case RX_END:
+        break;
+    default:
+        return false;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&rx_lock);
+    if (line_isr_seq - line_rd_seq < LINE_STAMPS) {
+        *out = line_stamps[line_rd_seq % LINE_STAMPS];
+    } else {
+        *out = (struct uart_io_line_times){ 0 };   /* overwritten, reader fell behind */
+    }
+    k_spin_unlock(&rx_lock, key);
+    return true;
+}
+
+int uart_io_write(const void *buf, uint32_t len, k_timeout_t timeout)
+{
+    if (len > CONFIG_UART_TX_BUF_SIZE) {
+        atomic_inc(&tx_dropped);
+        return -EMSGSIZE;
+    }
+
+    if (!io_dev) {
+        /* before uart_io_init(): fall back to the synchronous console */
+        printk("%.*s", (int)len, (const char *)buf);
+        return (int)len;
+    }
+
+    while (1) {
+        k_spinlock_key_t key = k_spin_lock(&tx_lock);
+        if (ring_buf_space_get(&tx_ring) >= len) {
+            ring_buf_put(&tx_ring, buf, len);
+            uint32_t used = ring_buf_size_get(&tx_ring);
+            uart_irq_tx_enable(io_dev);
+            k_spin_unlock(&tx_lock, key);
+
+            atomic_add(&tx_bytes, (atomic_val_t)len);
+            if ((atomic_val_t)used > atomic_get(&tx_high_water)) {
+                atomic_set(&tx_high_water, (atomic_val_t)used);
+            }
+            return (int)len;
+        }
+        k_spin_unlock(&tx_lock, key);
+
+        if (K_TIMEOUT_EQ(timeout, K_NO_WAIT) ||
+            k_sem_take(&tx_space_sem, timeout) != 0) {
+            atomic_inc(&tx_dropped);
+            return -EAGAIN;
+        }
+    }
+}
+
+static int uart_io_vprintf(k_timeout_t timeout, const char *fmt, va_list args)
+{
+    char line[UART_IO_LINE_MAX];
+
+    int n = vsnprintk(line, sizeof(line), fmt, args);
+    if (n < 0) return n;
+    if (n >= (int)sizeof(line)) n = sizeof(line) - 1;
+
+    return uart_io_write(line, (uint32_t)n, timeout);
+}
+
+int uart_io_printf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int ret = uart_io_vprintf(K_NO_WAIT, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int uart_io_printf_wait(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int ret = uart_io_vprintf(K_FOREVER, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int uart_io_flush(k_timeout_t timeout)
+{
+    while (1) {
+        k_spinlock_key_t key = k_spin_lock(&tx_lock);
+        bool empty = ring_buf_is_empty(&tx_ring);
+        k_spin_unlock(&tx_lock, key);
+
+        if (empty) return 0;
+        if (k_sem_take(&tx_idle_sem, timeout) != 0) return -EAGAIN;
+    }
+}
+
+void uart_io_stats_get(struct uart_io_stats *out)
+{
+    out->rx_bytes = (uint32_t)atomic_get(&rx_bytes);
+    out->rx_lines = (uint32_t)atomic_get(&rx_lines);
+    out->rx_overruns = (uint32_t)atomic_get(&rx_overruns);
+    out->rx_high_water = (uint32_t)atomic_get(&rx_high_water);
+    out->tx_bytes = (uint32_t)atomic_get(&tx_bytes);
+    out->tx_dropped = (uint32_t)atomic_get(&tx_dropped);
+    out->tx_high_water = (uint32_t)atomic_get(&tx_high_water);
+}
+
+void uart_io_stats_reset(void)
+{
+    atomic_clear(&rx_bytes);
+    atomic_clear(&rx_lines);
+    atomic_clear(&rx_overruns);
+
+    k_spinlock_key_t key = k_spin_lock(&rx_lock);
+    atomic_set(&rx_high_water, (atomic_val_t)ring_buf_size_get(&rx_ring));
+    k_spin_unlock(&rx_lock, key);
+
+    atomic_clear(&tx_bytes);
+    atomic_clear(&tx_dropped);
+
+    key = k_spin_lock(&tx_lock);
+    atomic_set(&tx_high_water, (atomic_val_t)ring_buf_size_get(&tx_ring));
+    k_spin_unlock(&tx_lock, key);
+}
@@ -0,0 +1,75 @@
+#ifndef UART_IO_H
+#define UART_IO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+/* Interrupt-driven console UART. The RX interrupt drains the hardware
+ * FIFO into a ring buffer (CONFIG_UART_RX_BUF_SIZE). It wakes the reader
+ * only when a text line or a 0x00 frame is complete, or when the ring is
+ * half full. Inside a frame only the closing 0x00 counts, not '\n' or
+ * '\r' in the frame data. The reading thread therefore sleeps between
+ * lines instead of polling.
+ *
+ * Output is queued in a second ring (CONFIG_UART_TX_BUF_SIZE) that the TX
+ * interrupt drains, so a writer only pays for a copy. Writes are all or
+ * nothing, so a line is never cut in half; a write that does not fit is
+ * dropped and counted unless the caller chose to wait for room. */
+
+/* Longest line uart_io_printf() formats; longer output is truncated. */
+#define UART_IO_LINE_MAX 128
+
+struct uart_io_stats {
+    uint32_t rx_bytes;
+    uint32_t rx_lines;        /* complete text lines and frames */
+    uint32_t rx_overruns;     /* bytes lost because the ring was full */
+    uint32_t rx_high_water;   /* most bytes waiting in the ring at once */
+    uint32_t tx_bytes;
+    uint32_t tx_dropped;      /* writes refused because the ring was full */
+    uint32_t tx_high_water;
+};
+
+/* Returns 0, or a negative errno if the device has no IRQ-driven API. */
+int uart_io_init(const struct device *dev);
+
+/* Waits until there is a complete line or frame (or half a ring) to
+ * read, or the timeout expires. Returns 0 or -EAGAIN. */
+int uart_io_wait_line(k_timeout_t timeout);
+
+/* Copies up to len buffered bytes; never blocks. */
+uint32_t uart_io_read(uint8_t *buf, uint32_t len);
+
+/* k_cycle_get_32() when the RX interrupt took in the first and the last
+ * byte of a line (0 = not recorded). */
+struct uart_io_line_times {
+    uint32_t first;
+    uint32_t done;
+};
+
+/* With CONFIG_CMD_TRACE, the reader passes every byte uart_io_read()
+ * returned through here, in order. At the '\n' or '\r' that ends a
+ * non-empty text line, or the 0x00 that closes a non-empty frame, it
+ * returns true and fills *out. Inside a frame only 0x00 ends it. */
+bool uart_io_line_track(uint8_t b, struct uart_io_line_times *out);
+
+/* Queues len bytes for transmission, waiting up to timeout for room
+ * (ISRs must pass K_NO_WAIT). Returns len, -EAGAIN if it did not fit in
+ * time, or -EMSGSIZE if it can never fit. */
+int uart_io_write(const void *buf, uint32_t len, k_timeout_t timeout);
+
+/* printk-style formatting into the TX ring. uart_io_printf() never
+ * blocks and is ISR-safe; uart_io_printf_wait() waits for room and is for
+ * threads whose output must not be lost (command replies). */
+int uart_io_printf(const char *fmt, ...);
+int uart_io_printf_wait(const char *fmt, ...);
+
+/* Waits until everything queued so far has been handed to the UART.
+ * Returns 0 or -EAGAIN. */
+int uart_io_flush(k_timeout_t timeout);
+
+void uart_io_stats_get(struct uart_io_stats *out);
+void uart_io_stats_reset(void);
+
+#endif /* UART_IO_H */